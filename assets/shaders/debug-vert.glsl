@@ -5,7 +5,16 @@ layout (location = 1) in vec3 aColor;
 
 out vec3 color;
 
-uniform mat4 camMatrix;
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
 
 void main()
 {
@@ -2,6 +2,12 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec4 aInstance; // xyz = position, w = radius
+layout (location = 4) in float aBodyIndex;
+
+// Positions kept on the GPU by the compute backend, used when uBodyBuffer is set.
+// They are in world space, the instances relative to the camera.
+layout (std430, binding = 3) readonly buffer BodyPositions { vec4 bodyPositions[]; };
 
 out vec3 color;
 out vec3 normal;
@@ -11,20 +17,28 @@ out vec3 lightPos;
 out vec3 lightColor;
 out vec3 ambientLight;
 
-uniform mat4 camMatrix;
-uniform mat4 model;
-uniform vec3 viewPos;
-uniform vec3 uLightPos;
-uniform vec3 uLightColor;
-uniform vec3 uAmbientLight;
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform bool uBodyBuffer;
 
 void main()
 {
-    gl_Position = camMatrix * model * vec4(aPos, 1);
+    vec3 center = uBodyBuffer ? bodyPositions[int(aBodyIndex)].xyz - uCameraOrigin : aInstance.xyz;
+    fragPos = center + aPos * aInstance.w;
+    gl_Position = camMatrix * vec4(fragPos, 1);
 
     color = aColor;
-    normal = mat3(transpose(inverse(model))) * aNormal;
-    fragPos = vec3(model * vec4(aPos, 1));
+    // Uniform scale keeps the unit sphere normal valid
+    normal = aNormal;
     camPos = viewPos;
     lightPos = uLightPos;
     lightColor = uLightColor;
@@ -0,0 +1,64 @@
+#version 460 core
+
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) readonly buffer Bodies { vec4 bodies[]; }; // xyz = position, w = G * mass
+// Static grid mesh, 6 floats per vertex (position, color)
+layout (std430, binding = 1) readonly buffer Vertices { float vertices[]; };
+layout (std430, binding = 2) buffer Highest { uint highest; };
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform vec3 uOffset; // grid center relative to the camera
+uniform int uBodyCount;
+uniform int uVertexCount;
+
+shared float s_Highest[256];
+
+// Must match grid-vert.glsl
+float Displacement(vec3 vertexPos)
+{
+    float total = 0.0;
+    for (int b = 0; b < uBodyCount; b++)
+    {
+        float distance_m = length(bodies[b].xyz - uCameraOrigin - vertexPos) * 1000.0;
+        float rs = 2.0 * bodies[b].w / (299792.0 * 299792.0); // Schwarzschild radius
+        total += 2.0 * sqrt(max(rs * (distance_m - rs), 0.0));
+    }
+    return total;
+}
+
+void main()
+{
+    uint v = gl_GlobalInvocationID.x;
+    uint local = gl_LocalInvocationID.x;
+
+    float value = 0.0;
+    if (v < uint(uVertexCount))
+    {
+        vec3 pos = vec3(vertices[v * 6], vertices[v * 6 + 1], vertices[v * 6 + 2]) + uOffset;
+        value = Displacement(pos);
+    }
+    s_Highest[local] = value;
+    barrier();
+
+    for (uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2)
+    {
+        if (local < stride)
+            s_Highest[local] = max(s_Highest[local], s_Highest[local + stride]);
+        barrier();
+    }
+
+    // Non-negative floats order the same as their bit patterns
+    if (local == 0)
+        atomicMax(highest, floatBitsToUint(s_Highest[0]));
+}
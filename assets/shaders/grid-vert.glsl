@@ -0,0 +1,45 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+// xyz = position, w = G * mass
+layout (std430, binding = 0) readonly buffer Bodies { vec4 bodies[]; };
+// Highest displacement as float bits, written by grid-reduce-comp.glsl
+layout (std430, binding = 2) readonly buffer Highest { uint highest; };
+
+out vec3 color;
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform vec3 uOffset; // grid center relative to the camera
+uniform int uBodyCount;
+
+float Displacement(vec3 vertexPos)
+{
+    float total = 0.0;
+    for (int b = 0; b < uBodyCount; b++)
+    {
+        float distance_m = length(bodies[b].xyz - uCameraOrigin - vertexPos) * 1000.0;
+        float rs = 2.0 * bodies[b].w / (299792.0 * 299792.0); // Schwarzschild radius
+        total += 2.0 * sqrt(max(rs * (distance_m - rs), 0.0));
+    }
+    return total;
+}
+
+void main()
+{
+    vec3 pos = aPos + uOffset;
+    pos.y = Displacement(pos) - uintBitsToFloat(highest) + uOffset.y;
+    gl_Position = camMatrix * vec4(pos, 1);
+    color = aColor;
+}
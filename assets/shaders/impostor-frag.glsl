@@ -0,0 +1,69 @@
+#version 460 core
+
+// The sphere's surface is always in front of the quad it is traced on
+layout (depth_less) out float gl_FragDepth;
+out vec4 FragColor;
+
+in vec3 color;
+in vec3 fragPos;
+flat in vec3 center;
+flat in float radius;
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform bool uGlow; // unlit like light-frag.glsl
+
+void main()
+{
+    // Ray from the camera through this fragment against the sphere. The squared
+    // distance of the centre from the ray avoids subtracting two large squares.
+    vec3 dir = normalize(fragPos - viewPos);
+    vec3 oc = center - viewPos;
+    float along = dot(oc, dir);
+    vec3 closest = oc - along * dir;
+    float h = radius * radius - dot(closest, closest);
+    if (h < 0.0)
+        discard;
+    vec3 hit = viewPos + dir * (along - sqrt(h));
+
+    vec4 clip = camMatrix * vec4(hit, 1);
+    gl_FragDepth = 0.5 * (gl_DepthRange.diff * (clip.z / clip.w) + gl_DepthRange.near + gl_DepthRange.far);
+
+    if (uGlow)
+    {
+        FragColor = vec4(color, 1.0f);
+        return;
+    }
+
+    // Same lighting as default-frag.glsl
+    float specularStrength = 1.0f;
+
+    vec3 ambient = uAmbientLight * uLightColor;
+
+    vec3 norm = (hit - center) / radius;
+    vec3 lightDir = normalize(uLightPos - hit);
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * uLightColor;
+
+    vec3 viewDir = normalize(viewPos - hit);
+    vec3 reflectDir = reflect(-lightDir, norm);
+
+    float spec = 0.0;
+    if (dot(norm, lightDir) > 0.0) {
+        spec = pow(max(dot(viewDir, reflectDir), 0.0), 16);
+    }
+    vec3 specular = specularStrength * spec * uLightColor;
+
+    vec3 result = (ambient + diffuse + specular) * color;
+    FragColor = vec4(result, 1.0f);
+}
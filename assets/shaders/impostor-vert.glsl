@@ -0,0 +1,49 @@
+#version 460 core
+layout (location = 1) in vec3 aColor;
+layout (location = 3) in vec4 aInstance; // xyz = position, w = radius
+layout (location = 4) in float aBodyIndex;
+
+// Positions kept on the GPU by the compute backend, used when uBodyBuffer is set.
+// They are in world space, the instances relative to the camera.
+layout (std430, binding = 3) readonly buffer BodyPositions { vec4 bodyPositions[]; };
+
+out vec3 color;
+out vec3 fragPos;
+flat out vec3 center;
+flat out float radius;
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform bool uBodyBuffer;
+
+void main()
+{
+    center = uBodyBuffer ? bodyPositions[int(aBodyIndex)].xyz - uCameraOrigin : aInstance.xyz;
+    radius = aInstance.w;
+
+    // Quad through the centre, square to the line of sight. Its half size is where
+    // the cone of rays touching the sphere crosses that plane, so it just covers
+    // the silhouette. The camera must be outside the sphere.
+    vec3 toCenter = center - viewPos;
+    float dist = length(toCenter);
+    vec3 forward = toCenter / dist;
+    vec3 up = abs(forward.y) < 0.99 ? vec3(0, 1, 0) : vec3(1, 0, 0);
+    vec3 right = normalize(cross(forward, up));
+    up = cross(right, forward);
+    float extent = radius * dist / sqrt(max(dist * dist - radius * radius, 1e-12));
+
+    // Triangle strip corners, counter-clockwise as seen from the camera
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    fragPos = center + (corner.x * right + corner.y * up) * extent;
+    gl_Position = camMatrix * vec4(fragPos, 1);
+    color = aColor;
+}
@@ -0,0 +1,28 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in float aAge;
+
+out vec3 color;
+out float alpha;
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform float uFade;
+
+void main()
+{
+    gl_Position = camMatrix * vec4(aPos, 1);
+    color = aColor;
+    alpha = 1.0 - clamp(aAge, 0.0, 1.0) * uFade;
+}
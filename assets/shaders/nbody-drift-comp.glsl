@@ -0,0 +1,23 @@
+#version 450 core
+
+// Opening half kick and full drift of the leapfrog step
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) buffer Positions { vec4 positions[]; };
+layout (std430, binding = 1) buffer Velocities { vec4 velocities[]; };
+layout (std430, binding = 2) readonly buffer Accelerations { vec4 accelerations[]; };
+
+uniform int uCount;
+uniform float uHalfStep;
+uniform float uStep;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= uint(uCount))
+        return;
+
+    vec3 velocity = velocities[i].xyz + accelerations[i].xyz * uHalfStep;
+    velocities[i].xyz = velocity;
+    positions[i].xyz += velocity * uStep;
+}
@@ -0,0 +1,52 @@
+#version 450 core
+
+// Tiled all-pairs gravity: each workgroup stages a tile of bodies in shared memory
+// and every invocation accumulates the tile's pull on its own body.
+layout (local_size_x = 256) in;
+
+layout (std430, binding = 0) readonly buffer Positions { vec4 positions[]; }; // xyz, w = G * mass
+layout (std430, binding = 1) buffer Velocities { vec4 velocities[]; };
+layout (std430, binding = 2) writeonly buffer Accelerations { vec4 accelerations[]; };
+
+uniform int uCount;
+uniform float uHalfStep;
+uniform float uSoftening2; // squared Plummer softening length
+
+shared vec4 s_Tile[256];
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    uint local = gl_LocalInvocationID.x;
+    vec4 body = i < uint(uCount) ? positions[i] : vec4(0.0);
+
+    vec3 acceleration = vec3(0.0);
+    for (uint tile = 0; tile < uint(uCount); tile += gl_WorkGroupSize.x)
+    {
+        uint j = tile + local;
+        s_Tile[local] = j < uint(uCount) ? positions[j] : vec4(0.0);
+        barrier();
+
+        uint tileCount = min(gl_WorkGroupSize.x, uint(uCount) - tile);
+        for (uint k = 0; k < tileCount; k++)
+        {
+            vec3 d = s_Tile[k].xyz - body.xyz;
+            float dist2 = dot(d, d) + uSoftening2;
+            // Skips the body itself and exact overlaps, like the CPU solvers
+            if (dist2 > 0.0)
+            {
+                float invDist = inversesqrt(dist2);
+                acceleration += d * (s_Tile[k].w * invDist * invDist * invDist);
+            }
+        }
+        barrier();
+    }
+
+    if (i >= uint(uCount))
+        return;
+    // Massless bodies are left alone, matching Gravity
+    if (body.w == 0.0)
+        acceleration = vec3(0.0);
+    accelerations[i] = vec4(acceleration, 0.0);
+    velocities[i].xyz += acceleration * uHalfStep;
+}
@@ -0,0 +1,14 @@
+#version 460 core
+
+out vec4 FragColor;
+
+in vec3 color;
+
+void main()
+{
+    // Round sprites
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    if (dot(offset, offset) > 1.0)
+        discard;
+    FragColor = vec4(color, 1.0f);
+}
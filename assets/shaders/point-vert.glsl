@@ -0,0 +1,42 @@
+#version 460 core
+layout (location = 1) in vec3 aColor;
+layout (location = 3) in vec4 aInstance; // xyz = position, w = radius
+layout (location = 4) in float aBodyIndex;
+
+// Positions kept on the GPU by the compute backend, used when uBodyBuffer is set.
+// They are in world space, the instances relative to the camera.
+layout (std430, binding = 3) readonly buffer BodyPositions { vec4 bodyPositions[]; };
+
+out vec3 color;
+
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
+
+uniform bool uBodyBuffer;
+uniform bool uGlow;
+uniform float uPixelsPerUnit; // viewport height / (2 tan(fov / 2))
+
+void main()
+{
+    vec3 center = uBodyBuffer ? bodyPositions[int(aBodyIndex)].xyz - uCameraOrigin : aInstance.xyz;
+    gl_Position = camMatrix * vec4(center, 1);
+    gl_PointSize = max(2.0 * aInstance.w * uPixelsPerUnit / max(length(center - viewPos), 1e-6), 1.0);
+
+    // A body this small is a dot; light it as the disc facing the camera
+    vec3 lit = aColor;
+    if (!uGlow)
+    {
+        vec3 norm = normalize(viewPos - center);
+        float diff = max(dot(norm, normalize(uLightPos - center)), 0.0);
+        lit = (uAmbientLight * uLightColor + diff * uLightColor) * aColor;
+    }
+    color = lit;
+}
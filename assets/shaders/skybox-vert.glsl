@@ -3,11 +3,19 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 camMatrix;
-uniform mat4 model;
+// Per-frame camera and lighting, written once per frame by FrameUniforms
+layout (std140, binding = 0) uniform Frame
+{
+    mat4 camMatrix;
+    vec3 viewPos;
+    vec3 uCameraOrigin; // bodies that only live on the GPU are in world space
+    vec3 uLightPos;
+    vec3 uLightColor;
+    vec3 uAmbientLight;
+};
 
 void main()
 {
     TexCoords = aPos;
-    gl_Position = camMatrix * model * vec4(aPos, 1.0);
+    gl_Position = camMatrix * vec4(aPos, 1.0);
 }  
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/engine/ForceKernel.h"
+#include "../src/engine/ParticleSystem.h"
+
+// Micro-benchmark for the direct-summation kernels
+// usage: force_bench [bodies] [iterations]
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8192;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	ParticleSystem particles;
+	particles.Reserve(count);
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> position(-10000.0f, 10000.0f);
+	std::uniform_real_distribution<double> mass(1e18, 1e22);
+	for (size_t i = 0; i < count; i++)
+		particles.Add(Vec3(position(rng), position(rng), position(rng)), Vec3(0), mass(rng), 5515);
+
+	ForceKernel kernel;
+	SimdLevel best = ForceKernel::GetSupportedLevel();
+	std::printf("bodies: %zu, iterations: %d, detected: %s\n", count, iterations, GetSimdLevelName(best));
+
+	std::vector<glm::vec3> reference, accelerations;
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512 };
+	for (SimdLevel level : levels)
+	{
+		if (level > best)
+			break;
+		kernel.SetLevel(level);
+		kernel.Compute(particles.Positions, particles.Masses, 0.0f, accelerations); // warm up
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++)
+			kernel.Compute(particles.Positions, particles.Masses, 0.0f, accelerations);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (level == SimdLevel::Scalar)
+			reference = accelerations;
+		double maxError = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			double magnitude = glm::length(reference[i]);
+			if (magnitude > 0)
+				maxError = std::max(maxError, double(glm::length(accelerations[i] - reference[i])) / magnitude);
+		}
+
+		double pairs = double(count) * double(count) * iterations;
+		std::printf("%-8s %10.3f ms/step %10.3f Gpairs/s  max rel err %.2e\n",
+			GetSimdLevelName(level), seconds * 1000.0 / iterations, pairs / seconds * 1e-9, maxError);
+	}
+	return 0;
+}
@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../src/engine/Scenario.h"
+#include "../src/engine/Simulation.h"
+#include "../src/engine/TrajectoryPredictor.h"
+#include "../src/engine/GpuNBody.h"
+#include "../src/engine/Grid.h"
+#include "../src/renderer/Camera.h"
+#include "../src/renderer/FrameUniforms.h"
+#include "../src/utils/ThreadPool.h"
+
+// Times the standard workloads per stage and backend and writes the results as JSON,
+// so runs of different builds can be compared. Run from the build directory (assets).
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+	std::vector<size_t> Sizes = { 1000, 10000, 100000 };
+	std::vector<std::string> Workloads = { "plummer", "disk", "solar" };
+	std::vector<std::string> Backends = { "direct", "simd", "barnes-hut", "fmm", "gpu" };
+	std::string Output;
+	uint32_t Seed = 42;
+	double Budget = 0.5;		   // seconds spent repeating one measurement
+	int TrajectoryLength = 16;	   // samples predicted per trajectory run
+	size_t MaxDirect = 10000;	   // all-pairs CPU solvers get slow beyond this
+	unsigned int Threads = 0;
+};
+
+struct Timing
+{
+	double Mean = 0, Min = 0; // milliseconds
+	int Reps = 0;
+};
+
+struct Result
+{
+	std::string Workload;
+	size_t Bodies;
+	std::string Backend;
+	const char* Stage;
+	Timing Time;
+};
+
+static void PrintUsage()
+{
+	std::cout <<
+		"usage: universe_bench [options]\n"
+		"  --sizes <n,...>         body counts (default 1000,10000,100000)\n"
+		"  --workloads <name,...>  plummer | disk | solar (default all)\n"
+		"  --backends <name,...>   direct | simd | barnes-hut | fmm | gpu (default all)\n"
+		"  --seed <s>              generator seed (default 42)\n"
+		"  --budget <seconds>      time spent repeating each measurement (default 0.5)\n"
+		"  --trajectory <n>        trajectory samples to predict (default 16)\n"
+		"  --max-direct <n>        largest body count for the all-pairs CPU solvers (default 10000)\n"
+		"  --threads <n>           worker threads, 0 = all cores (default 0)\n"
+		"  --output <file>         JSON file to write (default: stdout)\n";
+}
+
+template<typename T>
+static std::vector<T> SplitList(const char* value, T (*parse)(const std::string&))
+{
+	std::vector<T> items;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			items.push_back(parse(item));
+	return items;
+}
+
+static bool Contains(const std::vector<std::string>& list, const char* name)
+{
+	return std::find(list.begin(), list.end(), name) != list.end();
+}
+
+// Runs fn once to warm up (first steps, thread start-up, lazy allocations), then
+// repeats it until the budget is spent, at least once. reset, when given, runs
+// untimed before every call so each rep starts from the same state.
+static Timing Measure(double budget, const std::function<void()>& fn, const std::function<void()>& reset = nullptr)
+{
+	if (reset)
+		reset();
+	fn();
+
+	Timing timing;
+	timing.Min = 1e300;
+	double total = 0;
+	auto start = Clock::now();
+	do
+	{
+		if (reset)
+			reset();
+		auto begin = Clock::now();
+		fn();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+		total += ms;
+		timing.Min = std::min(timing.Min, ms);
+		timing.Reps++;
+	} while (timing.Reps < 1000 && std::chrono::duration<double>(Clock::now() - start).count() < budget);
+	timing.Mean = total / timing.Reps;
+	return timing;
+}
+
+static bool Generate(const std::string& workload, size_t count, uint32_t seed, ParticleSystem& particles)
+{
+	if (workload == "plummer")
+		GeneratePlummerSphere(particles, count, seed);
+	else if (workload == "disk")
+		GenerateDiskGalaxy(particles, count, seed);
+	else if (workload == "solar")
+		GenerateSolarSystem(particles, count, seed);
+	else
+		return false;
+	return true;
+}
+
+// Hidden window for the GPU stages; nullptr if no suitable context is available
+static GLFWwindow* CreateContext()
+{
+	if (!glfwInit())
+		return nullptr;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(640, 360, "universe_bench", nullptr, nullptr);
+	if (!window)
+	{
+		glfwTerminate();
+		return nullptr;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return nullptr;
+	}
+	glEnable(GL_DEPTH_TEST);
+	return window;
+}
+
+static void WriteJson(std::ostream& out, const Options& options, const std::string& renderer, const std::vector<Result>& results)
+{
+	out.setf(std::ios::fixed);
+	out.precision(4);
+	out << "{\n";
+	out << "  \"version\": 1,\n";
+	out << "  \"seed\": " << options.Seed << ",\n";
+	out << "  \"threads\": " << ThreadPool::Get().GetThreadCount() << ",\n";
+	out << "  \"simd\": \"" << GetSimdLevelName(ForceKernel::GetSupportedLevel()) << "\",\n";
+	out << "  \"gl_renderer\": \"" << renderer << "\",\n";
+	out << "  \"trajectory_length\": " << options.TrajectoryLength << ",\n";
+	out << "  \"results\": [";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+		out << (i ? ",\n" : "\n") << "    { \"workload\": \"" << result.Workload << "\", \"bodies\": " << result.Bodies
+			<< ", \"backend\": \"" << result.Backend << "\", \"stage\": \"" << result.Stage
+			<< "\", \"mean_ms\": " << result.Time.Mean << ", \"min_ms\": " << result.Time.Min
+			<< ", \"reps\": " << result.Time.Reps << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (arg == "--help" || arg == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		if (!value)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return -1;
+		}
+		i++;
+
+		if (arg == "--sizes")
+			options.Sizes = SplitList<size_t>(value, [](const std::string& s) { return size_t(std::strtoull(s.c_str(), nullptr, 10)); });
+		else if (arg == "--workloads")
+			options.Workloads = SplitList<std::string>(value, [](const std::string& s) { return s; });
+		else if (arg == "--backends")
+			options.Backends = SplitList<std::string>(value, [](const std::string& s) { return s; });
+		else if (arg == "--seed")
+			options.Seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (arg == "--budget")
+			options.Budget = std::atof(value);
+		else if (arg == "--trajectory")
+			options.TrajectoryLength = std::max(std::atoi(value), 1);
+		else if (arg == "--max-direct")
+			options.MaxDirect = std::strtoull(value, nullptr, 10);
+		else if (arg == "--threads")
+			options.Threads = static_cast<unsigned int>(std::atoi(value));
+		else if (arg == "--output")
+			options.Output = value;
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+			PrintUsage();
+			return -1;
+		}
+	}
+	ThreadPool::Get().Resize(options.Threads);
+
+	GLFWwindow* window = nullptr;
+	std::string renderer = "none";
+	if (Contains(options.Backends, "gpu"))
+	{
+		window = CreateContext();
+		if (window)
+			renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+		else
+			std::cerr << "No OpenGL 4.6 context, skipping the GPU stages" << std::endl;
+	}
+
+	struct CpuBackend
+	{
+		const char* Name;
+		GravitySolver Solver;
+		bool AllPairs;
+	};
+	const CpuBackend cpuBackends[] = {
+		{ "direct", GravitySolver::Direct, true },
+		{ "simd", GravitySolver::DirectSimd, true },
+		{ "barnes-hut", GravitySolver::BarnesHut, false },
+		{ "fmm", GravitySolver::Fmm, false },
+	};
+
+	std::vector<Result> results;
+	auto record = [&](const std::string& workload, size_t bodies, const char* backend, const char* stage, const Timing& time)
+	{
+		results.push_back({ workload, bodies, backend, stage, time });
+		std::fprintf(stderr, "%-8s %7zu %-11s %-11s %10.3f ms (min %.3f, %d reps)\n",
+			workload.c_str(), bodies, backend, stage, time.Mean, time.Min, time.Reps);
+	};
+
+	Simulation simulation;
+	const float stepSize = simulation.GetStepSize();
+	for (const std::string& workload : options.Workloads)
+	{
+		for (size_t count : options.Sizes)
+		{
+			ParticleSystem particles;
+			if (!Generate(workload, count, options.Seed, particles))
+			{
+				std::cerr << "Unknown workload: " << workload << std::endl;
+				return -1;
+			}
+
+			// Integration alone, with the force evaluation stubbed out
+			{
+				std::vector<Vec3> positions = particles.Positions, velocities = particles.Velocities;
+				Integrator integrator;
+				Timing time = Measure(options.Budget, [&]
+				{
+					integrator.Step(IntegratorScheme::Leapfrog, positions, velocities, stepSize,
+						[](const std::vector<Vec3>& p, std::vector<glm::vec3>& a) { a.assign(p.size(), glm::vec3(0.0f)); });
+				});
+				record(workload, count, "cpu", "integrate", time);
+			}
+
+			// Broad and narrow phase of the collision pass
+			{
+				Collisions collisions;
+				record(workload, count, "cpu", "collisions", Measure(options.Budget, [&]
+				{
+					collisions.FindContacts(particles);
+				}));
+			}
+
+			for (const CpuBackend& backend : cpuBackends)
+			{
+				if (!Contains(options.Backends, backend.Name))
+					continue;
+				if (backend.AllPairs && count > options.MaxDirect)
+				{
+					std::fprintf(stderr, "%-8s %7zu %-11s skipped (--max-direct %zu)\n", workload.c_str(), count, backend.Name, options.MaxDirect);
+					continue;
+				}
+				GravitySettings settings;
+				settings.Solver = backend.Solver;
+
+				Gravity gravity;
+				std::vector<glm::vec3> accelerations;
+				record(workload, count, backend.Name, "force", Measure(options.Budget, [&]
+				{
+					gravity.ComputeAccelerations(particles, settings, accelerations);
+				}));
+
+				// Every rep times the second step from the generated state, so the result does
+				// not depend on the budget; the untimed first step fills the force caches
+				auto restart = [&]
+				{
+					simulation.Particles = particles;
+					simulation.Invalidate();
+					simulation.Step(stepSize);
+				};
+				simulation.GravityParams = settings;
+				record(workload, count, backend.Name, "step", Measure(options.Budget, [&]
+				{
+					simulation.Step(stepSize);
+				}, restart));
+
+				// Block timesteps: each tick drifts every body and rebuilds the solver's tree,
+				// but only evaluates the forces of the active bodies
+				simulation.AdaptiveTimesteps = true;
+				record(workload, count, backend.Name, "adaptive", Measure(options.Budget, [&]
+				{
+					simulation.Step(stepSize);
+				}, restart));
+				std::fprintf(stderr, "%-8s %7zu %-11s %-11s deepest level %d, %zu force evaluations per step\n", workload.c_str(), count, backend.Name, "adaptive",
+					simulation.Blocks.GetDeepestLevel(), simulation.Blocks.GetForceEvaluations());
+				simulation.AdaptiveTimesteps = false;
+
+				// A full prediction from scratch, as after an edit
+				simulation.Particles = particles;
+				TrajectoryPredictor predictor;
+				TrajectorySet paths;
+				record(workload, count, backend.Name, "trajectory", Measure(options.Budget, [&]
+				{
+					simulation.Invalidate();
+					predictor.Update(simulation, options.TrajectoryLength);
+					while (!predictor.Fetch(paths) || paths.Length < size_t(options.TrajectoryLength))
+						std::this_thread::sleep_for(std::chrono::microseconds(50));
+				}));
+			}
+
+			if (window)
+			{
+				GpuNBody gpu;
+				ParticleSystem state = particles;
+				record(workload, count, "gpu", "step", Measure(options.Budget, [&]
+				{
+					gpu.Step(state, stepSize, GravitySettings());
+					glFinish();
+				}));
+				gpu.Destroy();
+
+				// Grid deformation: body upload, highest point reduction and the displaced mesh
+				Shader gridShader("assets/shaders/grid-vert.glsl", "assets/shaders/debug-frag.glsl");
+				Shader reduceShader("assets/shaders/grid-reduce-comp.glsl");
+				Grid grid(20000, 100);
+				Camera camera(640, 360, Vec3(0.0f, 5000.0f, 25000.0f), 80.0f, 0.1f, 500000.0f);
+				camera.LookAt(Vec3(0));
+				camera.UpdateMatrix();
+				FrameUniforms frameUniforms;
+				record(workload, count, "gpu", "grid", Measure(options.Budget, [&]
+				{
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					frameUniforms.Update(camera);
+					grid.Update(particles, Vec3(0), camera, reduceShader);
+					grid.Render(gridShader);
+					glFinish();
+					StreamBuffer::EndFrame();
+				}));
+				grid.Destroy();
+				gridShader.Delete();
+				reduceShader.Delete();
+			}
+		}
+	}
+
+	if (window)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	if (options.Output.empty())
+	{
+		WriteJson(std::cout, options, renderer, results);
+		return 0;
+	}
+	std::ofstream out(options.Output);
+	if (!out)
+	{
+		std::cerr << "Error opening file: " << options.Output << std::endl;
+		return -1;
+	}
+	WriteJson(out, options, renderer, results);
+	return 0;
+}
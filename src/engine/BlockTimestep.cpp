@@ -0,0 +1,111 @@
+#include "BlockTimestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/ThreadPool.h"
+
+int BlockTimestep::ChooseLevel(size_t i, float dt, float bodyDt, const glm::vec3& oldAcceleration) const
+{
+	const glm::vec3& a = m_Accelerations[i];
+	float accel = glm::length(a);
+	if (accel == 0)
+		return 0;
+
+	// Aarseth-style a/jerk criterion, with the jerk estimated from the change in
+	// acceleration over the body's last step. Before any history exists, use v/a.
+	float timescale;
+	float jerk = bodyDt != 0 ? glm::length(a - oldAcceleration) / std::abs(bodyDt) : 0.0f;
+	if (jerk > 0)
+		timescale = accel / jerk;
+	else
+		timescale = static_cast<float>(glm::length(m_Particles->Velocities[i])) / accel;
+
+	float desired = Eta * timescale;
+	if (!(desired > 0) || desired >= std::abs(dt))
+		return 0;
+	int level = static_cast<int>(std::ceil(std::log2(std::abs(dt) / desired)));
+	return std::min(std::max(level, 0), MaxLevel);
+}
+
+void BlockTimestep::Step(ParticleSystem& particles, float dt, Gravity& gravity, const GravitySettings& settings)
+{
+	const size_t count = particles.Size();
+	MaxLevel = std::min(std::max(MaxLevel, 0), 30);
+	m_Particles = &particles;
+	m_ForceEvaluations = 0;
+
+	if (!m_Valid || m_Levels.size() != count)
+	{
+		gravity.ComputeAccelerations(particles.Positions, particles.Masses, settings, m_Accelerations);
+		m_ForceEvaluations += count;
+		m_Levels.resize(count);
+		for (size_t i = 0; i < count; i++)
+			m_Levels[i] = static_cast<uint8_t>(ChooseLevel(i, dt, 0, m_Accelerations[i]));
+		m_Valid = true;
+	}
+
+	const uint32_t total = 1u << MaxLevel;
+	auto span = [&](int level) { return total >> level; };
+	auto stepOf = [&](int level) { return dt / static_cast<float>(1u << level); };
+
+	// Opening half kick for every body
+	m_NextTick.resize(count);
+	m_DeepestLevel = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		m_Levels[i] = static_cast<uint8_t>(std::min<int>(m_Levels[i], MaxLevel));
+		m_NextTick[i] = span(m_Levels[i]);
+		particles.Velocities[i] += Vec3(m_Accelerations[i]) * Real(0.5f * stepOf(m_Levels[i]));
+		m_DeepestLevel = std::max<int>(m_DeepestLevel, m_Levels[i]);
+	}
+
+	uint32_t tick = 0;
+	while (tick < total)
+	{
+		uint32_t next = total;
+		for (uint32_t t : m_NextTick)
+			next = std::min(next, t);
+
+		// Drift everyone to the next time any step ends
+		float drift = dt * static_cast<float>(next - tick) / static_cast<float>(total);
+		ThreadPool::Get().ParallelFor(0, count, 4096, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				particles.Positions[i] += particles.Velocities[i] * Real(drift);
+		});
+		tick = next;
+
+		m_Active.clear();
+		for (size_t i = 0; i < count; i++)
+			if (m_NextTick[i] == tick)
+				m_Active.push_back(static_cast<uint32_t>(i));
+
+		gravity.ComputeAccelerations(particles.Positions, particles.Masses, settings, m_Active, m_Scratch);
+		m_ForceEvaluations += m_Active.size();
+
+		for (uint32_t i : m_Active)
+		{
+			int level = m_Levels[i];
+			float bodyDt = stepOf(level);
+			glm::vec3 oldAcceleration = m_Accelerations[i];
+			m_Accelerations[i] = m_Scratch[i];
+			particles.Velocities[i] += Vec3(m_Accelerations[i]) * Real(0.5f * bodyDt); // closing kick
+
+			// Refine freely; coarsen one level at a time and only where the coarser step lines up
+			int desired = ChooseLevel(i, dt, bodyDt, oldAcceleration);
+			if (desired > level)
+				level = desired;
+			else if (desired < level && tick % span(level - 1) == 0)
+				level = level - 1;
+			m_Levels[i] = static_cast<uint8_t>(level);
+			m_DeepestLevel = std::max(m_DeepestLevel, level);
+
+			if (tick < total)
+			{
+				particles.Velocities[i] += Vec3(m_Accelerations[i]) * Real(0.5f * stepOf(level)); // next opening kick
+				m_NextTick[i] = tick + span(level);
+			}
+		}
+	}
+}
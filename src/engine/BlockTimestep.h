@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ParticleSystem.h"
+#include "Gravity.h"
+
+// Hierarchical power-of-two individual timesteps (block timestepping) on top of a
+// kick-drift-kick leapfrog. Every body sits on a level L and steps by dt / 2^L; all
+// levels line up again at the end of each Step(). Forces are only evaluated for the
+// bodies whose step ends at a given tick, while every body is drifted to that time.
+// The force pass scales with the active bodies, but Barnes-Hut and FMM still rebuild
+// their tree (and FMM its multipoles) from every body at each tick; universe_bench's
+// "adaptive" stage measures this against the fixed "step".
+class BlockTimestep
+{
+public:
+	void Step(ParticleSystem& particles, float dt, Gravity& gravity, const GravitySettings& settings);
+	void Invalidate() { m_Valid = false; }
+
+	const std::vector<uint8_t>& GetLevels() const { return m_Levels; }
+	int GetDeepestLevel() const { return m_DeepestLevel; }
+	size_t GetForceEvaluations() const { return m_ForceEvaluations; }
+
+	int MaxLevel = 8;	 // finest step is dt / 2^MaxLevel
+	float Eta = 0.02f;	 // accuracy parameter, smaller is more accurate
+private:
+	int ChooseLevel(size_t i, float dt, float bodyDt, const glm::vec3& oldAcceleration) const;
+
+	std::vector<uint8_t> m_Levels;
+	std::vector<uint32_t> m_NextTick;
+	std::vector<uint32_t> m_Active;
+	std::vector<glm::vec3> m_Accelerations;
+	std::vector<glm::vec3> m_Scratch;
+	const ParticleSystem* m_Particles = nullptr;
+	bool m_Valid = false;
+
+	int m_DeepestLevel = 0;
+	size_t m_ForceEvaluations = 0;
+};
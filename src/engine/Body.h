@@ -1,56 +1,31 @@
 #pragma once
-#define GLM_ENABLE_EXPERIMENTAL
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/rotate_vector.hpp>
-#include <glm/gtx/vector_angle.hpp>
 
-#include "../src/renderer/Shader.h"
-#include "../src/renderer/Camera.h"
-#include "../src/renderer/gl/VAO.h"
-#include "../src/renderer/gl/VBO.h"
-#include "../src/renderer/gl/EBO.h"
-#include "../src/utils/Math.h"
+#include "ParticleSystem.h"
 
-// Physics body
+// Lightweight handle to one body stored in a ParticleSystem
 class Body
 {
 public:
-	Body(glm::vec3 pos, glm::vec3 vel, double mass, float density, glm::vec3 color=glm::vec3(1,1,1), bool glows=false);
+	Body(ParticleSystem& system, size_t index);
+
+	void RefreshRadius();
 
-	void Accelerate(const glm::vec3& force, float SIM_SPEED);
-	void Render(Shader& shader, Camera& camera);
-	glm::vec3 GetForce(Body& other);
-	void Update(float SIM_SPEED);
-	void RefreshMesh();
-	void Destroy();
+	Vec3& Position() const { return m_System->Positions[Index]; }
+	Vec3& Velocity() const { return m_System->Velocities[Index]; }
+	glm::vec3& Color() const { return m_System->Colors[Index]; }
+	double& Mass() const { return m_System->Masses[Index]; }
+	float& Radius() const { return m_System->Radii[Index]; }
+	float& Density() const { return m_System->Densities[Index]; }
+	bool Glows() const { return m_System->Glows[Index] != 0; }
+	void SetGlows(bool glows) const { m_System->Glows[Index] = glows; }
 
 	bool operator==(const Body& other) const
 	{
-		return Position == other.Position &&
-			Velocity == other.Velocity &&
-			Mass == other.Mass &&
-			Radius == other.Radius;
+		return m_System == other.m_System && Index == other.Index;
 	}
 
-	glm::vec3 Position;
-	glm::vec3 Color;
-	glm::vec3 Velocity;
-	double Mass;
-	float Radius, Density;
-	bool Glows;
+	size_t Index;
 private:
-	glm::mat4 m_ModelMatrix = glm::mat4(1.0f);
-	VAO m_VAO;
-	VBO* m_VBO;
-	EBO* m_EBO;
-
-	std::vector<GLfloat> m_Vertices;
-	std::vector<GLuint> m_Indices;
-
-	void GenerateVertices();
-};
\ No newline at end of file
+	ParticleSystem* m_System;
+};
@@ -0,0 +1,292 @@
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../utils/MappedFile.h"
+
+static const char Magic[8] = { 'U', 'N', 'I', 'V', 'C', 'K', 'P', 'T' };
+static const uint64_t Alignment = 64;
+
+struct CheckpointHeader
+{
+	char Magic[8];
+	uint32_t Version;
+	uint32_t SectionCount;
+	uint64_t BodyCount;
+	double Time;
+	double FixedStep;
+	float Speed;
+	int32_t Scheme;
+	int32_t Solver;
+	float Theta;
+	int32_t AdaptiveTimesteps;
+	int32_t MaxLevel;
+	float Eta;
+	int32_t MaxSubsteps;
+};
+static_assert(sizeof(CheckpointHeader) == 72, "checkpoint header layout changed");
+
+// Contents of the Settings section. Fields are only ever appended; a shorter
+// section from an older writer leaves the remaining fields at their defaults.
+struct CheckpointSettings
+{
+	float Softening = GravitySettings().Softening;
+	int32_t Regularize = 0;
+	float RegularizationRadius = Regularization().Radius;
+	int32_t FmmOrder = GravitySettings().FmmOrder;
+};
+
+struct CheckpointSection
+{
+	uint32_t Id;
+	uint32_t ElementSize;
+	uint64_t Offset; // from the start of the file
+	uint64_t Size;	 // in bytes
+};
+static_assert(sizeof(CheckpointSection) == 24, "checkpoint section layout changed");
+
+enum SectionId : uint32_t
+{
+	Positions = 1,
+	Velocities,
+	Masses,
+	Radii,
+	Densities,
+	Colors,
+	Glows,
+	Settings
+};
+
+struct SectionData
+{
+	SectionId Id;
+	uint32_t ElementSize;
+	const void* Data;
+};
+
+bool SaveCheckpoint(const std::string& path, const Simulation& simulation)
+{
+	const ParticleSystem& particles = simulation.Particles;
+	CheckpointSettings settings;
+	settings.Softening = simulation.GravityParams.Softening;
+	settings.Regularize = simulation.Regularize;
+	settings.RegularizationRadius = simulation.Regularizer.Radius;
+	settings.FmmOrder = simulation.GravityParams.FmmOrder;
+
+	const SectionData sections[] = {
+		{ Positions, sizeof(Vec3), particles.Positions.data() },
+		{ Velocities, sizeof(Vec3), particles.Velocities.data() },
+		{ Masses, sizeof(double), particles.Masses.data() },
+		{ Radii, sizeof(float), particles.Radii.data() },
+		{ Densities, sizeof(float), particles.Densities.data() },
+		{ Colors, sizeof(glm::vec3), particles.Colors.data() },
+		{ Glows, sizeof(uint8_t), particles.Glows.data() },
+		{ Settings, sizeof(CheckpointSettings), &settings },
+	};
+	const uint32_t sectionCount = sizeof(sections) / sizeof(sections[0]);
+
+	CheckpointHeader header = {};
+	memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = CheckpointVersion;
+	header.SectionCount = sectionCount;
+	header.BodyCount = particles.Size();
+	header.Time = simulation.GetTime();
+	header.FixedStep = simulation.FixedStep;
+	header.Speed = simulation.Speed;
+	header.Scheme = static_cast<int32_t>(simulation.Scheme);
+	header.Solver = static_cast<int32_t>(simulation.GravityParams.Solver);
+	header.Theta = simulation.GravityParams.Theta;
+	header.AdaptiveTimesteps = simulation.AdaptiveTimesteps;
+	header.MaxLevel = simulation.Blocks.MaxLevel;
+	header.Eta = simulation.Blocks.Eta;
+	header.MaxSubsteps = simulation.MaxSubsteps;
+
+	CheckpointSection table[sectionCount];
+	uint64_t offset = sizeof(CheckpointHeader) + sizeof(table);
+	for (uint32_t s = 0; s < sectionCount; s++)
+	{
+		offset = (offset + Alignment - 1) / Alignment * Alignment;
+		uint64_t count = sections[s].Id == Settings ? 1 : header.BodyCount;
+		table[s] = { sections[s].Id, sections[s].ElementSize, offset, sections[s].ElementSize * count };
+		offset += table[s].Size;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Error opening file: " << path << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(table), sizeof(table));
+	const char padding[Alignment] = {};
+	uint64_t written = sizeof(header) + sizeof(table);
+	for (uint32_t s = 0; s < sectionCount; s++)
+	{
+		file.write(padding, std::streamsize(table[s].Offset - written));
+		file.write(static_cast<const char*>(sections[s].Data), std::streamsize(table[s].Size));
+		written = table[s].Offset + table[s].Size;
+	}
+	if (!file)
+	{
+		std::cerr << "Error writing checkpoint: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template<typename T>
+static bool ReadSection(const MappedFile& file, const CheckpointSection& section, uint64_t count, std::vector<T>& out)
+{
+	if (section.ElementSize != sizeof(T) || section.Size != count * sizeof(T))
+		return false;
+	out.resize(count);
+	memcpy(out.data(), file.GetData() + section.Offset, section.Size);
+	return true;
+}
+
+// State vectors of a build with the other precision are converted
+static bool ReadStateSection(const MappedFile& file, const CheckpointSection& section, uint64_t count, std::vector<Vec3>& out)
+{
+	if (section.ElementSize == sizeof(Vec3))
+		return ReadSection(file, section, count, out);
+
+	std::vector<glm::vec3> singles;
+	std::vector<glm::dvec3> doubles;
+	if (ReadSection(file, section, count, singles))
+	{
+		out.resize(count);
+		for (size_t i = 0; i < count; i++)
+			out[i] = Vec3(singles[i]);
+		return true;
+	}
+	if (ReadSection(file, section, count, doubles))
+	{
+		out.resize(count);
+		for (size_t i = 0; i < count; i++)
+			out[i] = Vec3(doubles[i]);
+		return true;
+	}
+	return false;
+}
+
+bool LoadCheckpoint(const std::string& path, Simulation& simulation)
+{
+	MappedFile file(path.c_str());
+	if (!file.IsOpen())
+		return false;
+
+	CheckpointHeader header;
+	if (file.GetSize() < sizeof(header))
+	{
+		std::cerr << "Not a checkpoint: " << path << std::endl;
+		return false;
+	}
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (memcmp(header.Magic, Magic, sizeof(Magic)) != 0)
+	{
+		std::cerr << "Not a checkpoint: " << path << std::endl;
+		return false;
+	}
+	if (header.Version > CheckpointVersion)
+	{
+		std::cerr << "Checkpoint version " << header.Version << " is newer than supported (" << CheckpointVersion << "): " << path << std::endl;
+		return false;
+	}
+	if (header.Scheme < 0 || header.Scheme > static_cast<int32_t>(IntegratorScheme::RK4) ||
+		header.Solver < 0 || header.Solver > static_cast<int32_t>(GravitySolver::Fmm) || !(header.FixedStep > 0) ||
+		header.MaxSubsteps <= 0 || !(header.Eta > 0))
+	{
+		std::cerr << "Malformed checkpoint settings: " << path << std::endl;
+		return false;
+	}
+	// Every section holds at least a byte per body; this also keeps the section
+	// size checks below (count * element size) from overflowing
+	if (header.BodyCount > file.GetSize() ||
+		sizeof(header) + uint64_t(header.SectionCount) * sizeof(CheckpointSection) > file.GetSize())
+	{
+		std::cerr << "Truncated checkpoint: " << path << std::endl;
+		return false;
+	}
+
+	// Read into a scratch system so a damaged file leaves the simulation untouched
+	ParticleSystem particles;
+	CheckpointSettings settings;
+	uint32_t found = 0;
+	const uint8_t* tableData = file.GetData() + sizeof(header);
+	for (uint32_t s = 0; s < header.SectionCount; s++)
+	{
+		CheckpointSection section;
+		memcpy(&section, tableData + s * sizeof(section), sizeof(section));
+		if (section.Offset > file.GetSize() || section.Size > file.GetSize() - section.Offset)
+		{
+			std::cerr << "Truncated checkpoint: " << path << std::endl;
+			return false;
+		}
+
+		bool ok = true;
+		switch (section.Id)
+		{
+		case Positions: ok = ReadStateSection(file, section, header.BodyCount, particles.Positions); break;
+		case Velocities: ok = ReadStateSection(file, section, header.BodyCount, particles.Velocities); break;
+		case Masses: ok = ReadSection(file, section, header.BodyCount, particles.Masses); break;
+		case Radii: ok = ReadSection(file, section, header.BodyCount, particles.Radii); break;
+		case Densities: ok = ReadSection(file, section, header.BodyCount, particles.Densities); break;
+		case Colors: ok = ReadSection(file, section, header.BodyCount, particles.Colors); break;
+		case Glows: ok = ReadSection(file, section, header.BodyCount, particles.Glows); break;
+		case Settings:
+			memcpy(&settings, file.GetData() + section.Offset, std::min<uint64_t>(section.Size, sizeof(settings)));
+			break;
+		default: continue;
+		}
+		if (!ok)
+		{
+			std::cerr << "Malformed checkpoint section " << section.Id << ": " << path << std::endl;
+			return false;
+		}
+		found |= 1u << section.Id;
+	}
+
+	const uint32_t required = (1u << Positions) | (1u << Velocities) | (1u << Masses) | (1u << Densities);
+	if ((found & required) != required)
+	{
+		std::cerr << "Checkpoint is missing body data: " << path << std::endl;
+		return false;
+	}
+	if (!(settings.Softening >= 0) || !(settings.RegularizationRadius >= 0) || settings.FmmOrder < 1 || settings.FmmOrder > Fmm::MaxOrder)
+	{
+		std::cerr << "Malformed checkpoint settings: " << path << std::endl;
+		return false;
+	}
+	if (!(found & (1u << Colors)))
+		particles.Colors.assign(header.BodyCount, glm::vec3(1.0f));
+	if (!(found & (1u << Glows)))
+		particles.Glows.assign(header.BodyCount, 0);
+	if (!(found & (1u << Radii)))
+	{
+		particles.Radii.assign(header.BodyCount, 0.0f);
+		for (size_t i = 0; i < particles.Size(); i++)
+			particles.RefreshRadius(i);
+	}
+
+	simulation.Particles = std::move(particles);
+	simulation.SetTime(header.Time);
+	simulation.FixedStep = header.FixedStep;
+	simulation.Speed = header.Speed;
+	simulation.Scheme = static_cast<IntegratorScheme>(header.Scheme);
+	simulation.GravityParams.Solver = static_cast<GravitySolver>(header.Solver);
+	simulation.GravityParams.Theta = header.Theta;
+	simulation.GravityParams.Softening = settings.Softening;
+	simulation.GravityParams.FmmOrder = settings.FmmOrder;
+	simulation.Regularize = settings.Regularize != 0;
+	simulation.Regularizer.Radius = settings.RegularizationRadius;
+	simulation.AdaptiveTimesteps = header.AdaptiveTimesteps != 0;
+	simulation.Blocks.MaxLevel = header.MaxLevel;
+	simulation.Blocks.Eta = header.Eta;
+	simulation.MaxSubsteps = header.MaxSubsteps;
+	simulation.Invalidate();
+	return true;
+}
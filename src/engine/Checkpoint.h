@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+#include "Simulation.h"
+
+// Versioned binary snapshot of the body state and the simulation settings.
+//
+// Layout (little-endian): a CheckpointHeader, a table of SectionCount
+// CheckpointSection entries, then one 64-byte aligned array per section in the
+// ParticleSystem's own element format. Loaders skip sections they do not know,
+// so later versions can add arrays without breaking older files. Positions and
+// velocities are float or double vectors, whichever precision the writer used.
+// Since version 2 a settings section holds the gravity (softening, FMM order)
+// and regularization settings that do not fit the header; without it they keep
+// their defaults.
+const uint32_t CheckpointVersion = 2;
+
+bool SaveCheckpoint(const std::string& path, const Simulation& simulation);
+// Replaces the bodies, time and settings; the file is memory mapped, not read
+bool LoadCheckpoint(const std::string& path, Simulation& simulation);
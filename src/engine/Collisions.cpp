@@ -0,0 +1,262 @@
+#include "Collisions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <numeric>
+
+#include "../utils/ThreadPool.h"
+
+static const uint32_t LargeBody = UINT32_MAX;
+
+size_t Collisions::GetBucket(const glm::i64vec3& cell) const
+{
+	uint64_t hash = uint64_t(cell.x) * 73856093u ^ uint64_t(cell.y) * 19349663u ^ uint64_t(cell.z) * 83492791u;
+	return static_cast<size_t>(hash ^ (hash >> 29)) & m_Mask;
+}
+
+void Collisions::Build(const ParticleSystem& particles)
+{
+	size_t count = particles.Size();
+	m_Cells.resize(count);
+	m_Buckets.resize(count);
+
+	// Everything up to the radius just below the LargeBodies biggest ones fits in a cell.
+	// Ties stay small, so equal-sized bodies never end up on the brute-force path.
+	float cutoff = -1.0f;
+	if (count > LargeBodies)
+	{
+		m_Scratch = particles.Radii;
+		std::nth_element(m_Scratch.begin(), m_Scratch.begin() + LargeBodies, m_Scratch.end(), std::greater<float>());
+		cutoff = m_Scratch[LargeBodies];
+	}
+	m_CellSize = cutoff > 0 ? 2 * cutoff : 1.0f;
+
+	size_t tableSize = 64;
+	while (tableSize < 2 * count)
+		tableSize *= 2;
+	m_Mask = tableSize - 1;
+	if (m_CountCapacity < tableSize)
+	{
+		m_Counts.reset(new std::atomic<uint32_t>[tableSize]);
+		m_CountCapacity = tableSize;
+	}
+	ThreadPool& pool = ThreadPool::Get();
+	pool.ParallelFor(0, tableSize, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t b = begin; b < end; b++)
+			m_Counts[b].store(0, std::memory_order_relaxed);
+	});
+
+	// Counting sort by bucket: count, prefix sum, scatter
+	float inverseCell = 1.0f / m_CellSize;
+	pool.ParallelFor(0, count, 1024, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (particles.Radii[i] > cutoff)
+			{
+				m_Buckets[i] = LargeBody;
+				continue;
+			}
+			glm::dvec3 scaled = glm::floor(glm::dvec3(particles.Positions[i]) * double(inverseCell));
+			m_Cells[i] = glm::i64vec3(scaled);
+			size_t bucket = GetBucket(m_Cells[i]);
+			m_Buckets[i] = static_cast<uint32_t>(bucket);
+			m_Counts[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	m_Starts.resize(tableSize + 1);
+	m_Starts[0] = 0;
+	for (size_t b = 0; b < tableSize; b++)
+	{
+		m_Starts[b + 1] = m_Starts[b] + m_Counts[b].load(std::memory_order_relaxed);
+		m_Counts[b].store(0, std::memory_order_relaxed);
+	}
+
+	m_Entries.resize(m_Starts[tableSize]);
+	pool.ParallelFor(0, count, 1024, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t bucket = m_Buckets[i];
+			if (bucket != LargeBody)
+				m_Entries[m_Starts[bucket] + m_Counts[bucket].fetch_add(1, std::memory_order_relaxed)] = static_cast<uint32_t>(i);
+		}
+	});
+
+	m_Large.clear();
+	for (size_t i = 0; i < count; i++)
+		if (m_Buckets[i] == LargeBody)
+			m_Large.push_back(static_cast<uint32_t>(i));
+}
+
+static bool Overlap(const ParticleSystem& particles, size_t i, size_t j)
+{
+	Vec3 d = particles.Positions[j] - particles.Positions[i];
+	Real reach = Real(particles.Radii[i]) + particles.Radii[j];
+	return glm::dot(d, d) < reach * reach;
+}
+
+const std::vector<std::pair<uint32_t, uint32_t>>& Collisions::FindContacts(const ParticleSystem& particles)
+{
+	m_Contacts.clear();
+	Build(particles);
+
+	std::mutex mutex;
+	auto flush = [&](std::vector<std::pair<uint32_t, uint32_t>>& local)
+	{
+		if (local.empty())
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		m_Contacts.insert(m_Contacts.end(), local.begin(), local.end());
+	};
+
+	// Small bodies: the 27 cells around their own
+	ThreadPool::Get().ParallelFor(0, particles.Size(), 256, [&](size_t begin, size_t end)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> local;
+		for (size_t i = begin; i < end; i++)
+		{
+			if (m_Buckets[i] == LargeBody)
+				continue;
+			for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				glm::i64vec3 cell = m_Cells[i] + glm::i64vec3(dx, dy, dz);
+				size_t bucket = GetBucket(cell);
+				for (uint32_t k = m_Starts[bucket]; k < m_Starts[bucket + 1]; k++)
+				{
+					// Other cells can share the bucket; each pair is taken from its lower index
+					uint32_t j = m_Entries[k];
+					if (j > i && m_Cells[j] == cell && Overlap(particles, i, j))
+						local.emplace_back(static_cast<uint32_t>(i), j);
+				}
+			}
+		}
+		flush(local);
+	});
+
+	// Large bodies against everything
+	if (!m_Large.empty())
+	{
+		ThreadPool::Get().ParallelFor(0, particles.Size(), 1024, [&](size_t begin, size_t end)
+		{
+			std::vector<std::pair<uint32_t, uint32_t>> local;
+			for (size_t j = begin; j < end; j++)
+			{
+				for (uint32_t l : m_Large)
+				{
+					// Two large bodies are tested once, from the lower index
+					if (l == j || (m_Buckets[j] == LargeBody && j < l))
+						continue;
+					if (Overlap(particles, l, j))
+						local.emplace_back(std::min<uint32_t>(l, uint32_t(j)), std::max<uint32_t>(l, uint32_t(j)));
+				}
+			}
+			flush(local);
+		});
+	}
+
+	// Chunks finish in any order
+	std::sort(m_Contacts.begin(), m_Contacts.end());
+	return m_Contacts;
+}
+
+size_t Collisions::Find(size_t i)
+{
+	while (m_Parents[i] != i)
+	{
+		m_Parents[i] = m_Parents[m_Parents[i]];
+		i = m_Parents[i];
+	}
+	return i;
+}
+
+size_t Collisions::Resolve(ParticleSystem& particles)
+{
+	const std::vector<std::pair<uint32_t, uint32_t>>& contacts = FindContacts(particles);
+	if (contacts.empty())
+		return 0;
+
+	// Group touching bodies; every group is led by its heaviest member
+	size_t count = particles.Size();
+	m_Parents.resize(count);
+	std::iota(m_Parents.begin(), m_Parents.end(), 0u);
+	auto heavier = [&](size_t a, size_t b)
+	{
+		return particles.Masses[a] > particles.Masses[b] || (particles.Masses[a] == particles.Masses[b] && a < b);
+	};
+	for (const auto& contact : contacts)
+	{
+		size_t a = Find(contact.first), b = Find(contact.second);
+		if (a == b)
+			continue;
+		if (heavier(a, b))
+			m_Parents[b] = static_cast<uint32_t>(a);
+		else
+			m_Parents[a] = static_cast<uint32_t>(b);
+	}
+
+	// Fold every absorbed body into its leader: mass and momentum add up, the volume
+	// too, so the merged density is the total mass over the total volume
+	m_Removed.assign(count, 0);
+	size_t removed = 0;
+	for (const auto& contact : contacts)
+	{
+		for (uint32_t i : { contact.first, contact.second })
+		{
+			size_t leader = Find(i);
+			if (leader == i || m_Removed[i])
+				continue;
+			double massA = particles.Masses[leader], massB = particles.Masses[i];
+			double mass = massA + massB;
+			if (mass > 0)
+			{
+				particles.Positions[leader] = Vec3((glm::dvec3(particles.Positions[leader]) * massA + glm::dvec3(particles.Positions[i]) * massB) / mass);
+				particles.Velocities[leader] = Vec3((glm::dvec3(particles.Velocities[leader]) * massA + glm::dvec3(particles.Velocities[i]) * massB) / mass);
+				double volume = massA / particles.Densities[leader] + massB / particles.Densities[i];
+				if (volume > 0)
+					particles.Densities[leader] = static_cast<float>(mass / volume);
+			}
+			particles.Masses[leader] = mass;
+			particles.Glows[leader] |= particles.Glows[i];
+			m_Removed[i] = 1;
+			removed++;
+		}
+	}
+	for (const auto& contact : contacts)
+		particles.RefreshRadius(Find(contact.first));
+
+	// Where every old index ends up, chained onto the remap of earlier merges
+	std::vector<uint32_t> newIndex(count);
+	uint32_t next = 0;
+	for (size_t i = 0; i < count; i++)
+		newIndex[i] = m_Removed[i] ? 0 : next++;
+	std::vector<uint32_t> remap(count);
+	for (size_t i = 0; i < count; i++)
+		remap[i] = newIndex[Find(i)];
+	if (m_HasRemap)
+		for (uint32_t& index : m_Remap)
+			index = remap[index];
+	else
+		m_Remap = std::move(remap);
+	m_HasRemap = true;
+
+	particles.RemoveFlagged(m_Removed);
+	m_MergeCount += removed;
+	return removed;
+}
+
+bool Collisions::TakeRemap(std::vector<uint32_t>& remap)
+{
+	if (!m_HasRemap)
+		return false;
+	std::swap(remap, m_Remap);
+	m_Remap.clear();
+	m_HasRemap = false;
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include "ParticleSystem.h"
+
+// Finds overlapping bodies with a uniform spatial hash and merges them.
+// The cell size follows the radii: all but the LargeBodies biggest bodies fit in a
+// cell, so their contacts are among the 27 surrounding cells. The few large bodies
+// (stars next to thousands of asteroids) are tested against every body instead,
+// which keeps the whole pass linear in the body count.
+class Collisions
+{
+public:
+	// Overlapping pairs (i < j), sorted
+	const std::vector<std::pair<uint32_t, uint32_t>>& FindContacts(const ParticleSystem& particles);
+	// Merges every group of touching bodies into its heaviest member, conserving mass
+	// and momentum; returns the number of bodies removed
+	size_t Resolve(ParticleSystem& particles);
+
+	// Old index -> new index of the body it ended up in, for every Resolve since the
+	// last call; false if nothing merged
+	bool TakeRemap(std::vector<uint32_t>& remap);
+	uint64_t GetMergeCount() const { return m_MergeCount; }
+
+	static const size_t LargeBodies = 32;
+private:
+	void Build(const ParticleSystem& particles);
+	size_t GetBucket(const glm::i64vec3& cell) const;
+	size_t Find(size_t i);
+
+	// Spatial hash, rebuilt every call: bodies grouped by bucket (counting sort)
+	float m_CellSize = 1;
+	size_t m_Mask = 0;
+	std::vector<glm::i64vec3> m_Cells;
+	std::vector<uint32_t> m_Buckets; // per body, UINT32_MAX for large bodies
+	std::vector<uint32_t> m_Starts;
+	std::unique_ptr<std::atomic<uint32_t>[]> m_Counts;
+	size_t m_CountCapacity = 0;
+	std::vector<uint32_t> m_Entries;
+	std::vector<uint32_t> m_Large;
+	std::vector<float> m_Scratch;
+
+	std::vector<std::pair<uint32_t, uint32_t>> m_Contacts;
+	std::vector<uint32_t> m_Parents;
+	std::vector<uint8_t> m_Removed;
+	std::vector<uint32_t> m_Remap;
+	bool m_HasRemap = false;
+	uint64_t m_MergeCount = 0;
+};
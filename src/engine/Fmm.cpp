@@ -0,0 +1,553 @@
+#include "Fmm.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/ThreadPool.h"
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+static const int MaxTerms = (Fmm::MaxOrder + 1) * (Fmm::MaxOrder + 2) * (Fmm::MaxOrder + 3) / 6;
+static const int KeyBits = 21; // per axis, 63 bit Morton keys
+static const uint32_t NoCell = UINT32_MAX;
+
+static uint64_t SpreadBits(uint64_t x)
+{
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffff;
+	x = (x | x << 16) & 0x1f0000ff0000ff;
+	x = (x | x << 8) & 0x100f00f00f00f00f;
+	x = (x | x << 4) & 0x10c30c30c30c30c3;
+	x = (x | x << 2) & 0x1249249249249249;
+	return x;
+}
+
+static uint64_t CompactBits(uint64_t x)
+{
+	x &= 0x1249249249249249;
+	x = (x ^ x >> 2) & 0x10c30c30c30c30c3;
+	x = (x ^ x >> 4) & 0x100f00f00f00f00f;
+	x = (x ^ x >> 8) & 0x1f0000ff0000ff;
+	x = (x ^ x >> 16) & 0x1f00000000ffff;
+	x = (x ^ x >> 32) & 0x1fffff;
+	return x;
+}
+
+int Fmm::GetIndex(int x, int y, int z) const
+{
+	if (x < 0 || y < 0 || z < 0 || x + y + z > m_Order)
+		return -1;
+	int side = m_Order + 1;
+	return m_Lookup[(x * side + y) * side + z];
+}
+
+void Fmm::SetOrder(int order)
+{
+	order = std::max(1, std::min(order, MaxOrder));
+	if (order == m_Order)
+		return;
+	m_Order = order;
+
+	// Terms sorted by total order, so recurrences only look at earlier entries
+	int side = order + 1;
+	m_Terms.clear();
+	m_Lookup.assign(side * side * side, -1);
+	for (int o = 0; o <= order; o++)
+		for (int x = o; x >= 0; x--)
+			for (int y = o - x; y >= 0; y--)
+			{
+				Term term = {};
+				term.N[0] = x;
+				term.N[1] = y;
+				term.N[2] = o - x - y;
+				term.Order = o;
+				m_Lookup[(x * side + y) * side + term.N[2]] = static_cast<int>(m_Terms.size());
+				m_Terms.push_back(term);
+			}
+	for (Term& term : m_Terms)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			int n[3] = { term.N[0], term.N[1], term.N[2] };
+			n[axis]--;
+			term.Down[axis] = GetIndex(n[0], n[1], n[2]);
+			n[axis]--;
+			term.DownTwo[axis] = GetIndex(n[0], n[1], n[2]);
+			n[axis] += 3;
+			term.Up[axis] = GetIndex(n[0], n[1], n[2]);
+		}
+	}
+
+	const int terms = static_cast<int>(m_Terms.size());
+	m_OrderEnds.assign(order + 1, 0);
+	for (const Term& term : m_Terms)
+		m_OrderEnds[term.Order]++;
+	for (int o = 1; o <= order; o++)
+		m_OrderEnds[o] += m_OrderEnds[o - 1];
+
+	m_Shifts.clear();
+	m_Sums.assign(terms * terms, -1);
+	for (int high = 0; high < terms; high++)
+	{
+		const int* h = m_Terms[high].N;
+		for (int low = 0; low < terms; low++)
+		{
+			const int* l = m_Terms[low].N;
+			int difference = GetIndex(h[0] - l[0], h[1] - l[1], h[2] - l[2]);
+			if (difference >= 0)
+				m_Shifts.push_back({ low, high, difference });
+			m_Sums[high * terms + low] = GetIndex(h[0] + l[0], h[1] + l[1], h[2] + l[2]);
+		}
+	}
+}
+
+void Fmm::Monomials(const glm::dvec3& x, double* out) const
+{
+	out[0] = 1;
+	for (size_t t = 1; t < m_Terms.size(); t++)
+	{
+		const Term& term = m_Terms[t];
+		int axis = term.N[0] > 0 ? 0 : (term.N[1] > 0 ? 1 : 2);
+		out[t] = out[term.Down[axis]] * x[axis] / term.N[axis];
+	}
+}
+
+void Fmm::Derivatives(const glm::dvec3& r, double* out) const
+{
+	// |n| r^2 D_n = -(2|n| - 1) sum_i n_i r_i D_(n - e_i) - (|n| - 1) sum_i n_i (n_i - 1) D_(n - 2 e_i)
+	double r2 = glm::dot(r, r);
+	out[0] = 1 / sqrt(r2);
+	for (size_t t = 1; t < m_Terms.size(); t++)
+	{
+		const Term& term = m_Terms[t];
+		double first = 0, second = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (term.Down[axis] >= 0)
+				first += term.N[axis] * r[axis] * out[term.Down[axis]];
+			if (term.DownTwo[axis] >= 0)
+				second += term.N[axis] * (term.N[axis] - 1) * out[term.DownTwo[axis]];
+		}
+		out[t] = -((2 * term.Order - 1) * first + (term.Order - 1) * second) / (term.Order * r2);
+	}
+}
+
+void Fmm::Build(const std::vector<Vec3>& positions, const std::vector<double>& masses)
+{
+	// Massless bodies neither pull nor get pulled, so they stay out of the tree
+	m_Keys.clear();
+	glm::dvec3 minBound(0.0), maxBound(0.0);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		if (masses[i] == 0)
+			continue;
+		glm::dvec3 position(positions[i]);
+		minBound = m_Keys.empty() ? position : glm::min(minBound, position);
+		maxBound = m_Keys.empty() ? position : glm::max(maxBound, position);
+		m_Keys.emplace_back(0, static_cast<uint32_t>(i));
+	}
+	glm::dvec3 extent = maxBound - minBound;
+	double size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1.0)) * 1.0001;
+	double scale = double((1 << KeyBits) - 1) / size;
+	m_Origin = minBound;
+	m_Quantum = 1 / scale;
+
+	const size_t count = m_Keys.size();
+	ThreadPool& pool = ThreadPool::Get();
+	pool.ParallelFor(0, count, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t k = begin; k < end; k++)
+		{
+			glm::dvec3 q = (glm::dvec3(positions[m_Keys[k].second]) - minBound) * scale;
+			m_Keys[k].first = SpreadBits(uint64_t(q.x)) | SpreadBits(uint64_t(q.y)) << 1 | SpreadBits(uint64_t(q.z)) << 2;
+		}
+	});
+	std::sort(m_Keys.begin(), m_Keys.end());
+
+	m_Positions.resize(count);
+	m_Masses.resize(count);
+	m_X.resize(count);
+	m_Y.resize(count);
+	m_Z.resize(count);
+	m_GM.resize(count);
+	pool.ParallelFor(0, count, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t k = begin; k < end; k++)
+		{
+			m_Positions[k] = glm::dvec3(positions[m_Keys[k].second]);
+			m_Masses[k] = masses[m_Keys[k].second];
+			m_GM[k] = static_cast<float>(G * m_Masses[k]);
+		}
+	});
+
+	// Cells breadth first: a cell splits along the next Morton digit of its bodies
+	m_Cells.clear();
+	m_LevelStarts.assign(1, 0);
+	m_Leaves.clear();
+	if (count == 0)
+		return;
+	m_Cells.push_back({ glm::dvec3(0.0), 0.0, 0.0, 0, uint32_t(count), 0, 0, NoCell, 0 });
+	for (int level = 0; m_LevelStarts.back() < m_Cells.size(); level++)
+	{
+		uint32_t levelEnd = static_cast<uint32_t>(m_Cells.size());
+		for (uint32_t c = m_LevelStarts.back(); c < levelEnd; c++)
+		{
+			uint32_t begin = m_Cells[c].Begin, end = m_Cells[c].End;
+			if (end - begin <= LeafSize || level >= KeyBits)
+			{
+				m_Leaves.push_back(c);
+				continue;
+			}
+			int shift = 3 * (KeyBits - 1 - level);
+			m_Cells[c].FirstChild = static_cast<uint32_t>(m_Cells.size());
+			for (uint64_t digit = 0; digit < 8 && begin < end; digit++)
+			{
+				auto last = std::partition_point(m_Keys.begin() + begin, m_Keys.begin() + end, [&](const std::pair<uint64_t, uint32_t>& key)
+				{
+					return ((key.first >> shift) & 7) <= digit;
+				});
+				uint32_t split = static_cast<uint32_t>(last - m_Keys.begin());
+				if (split > begin)
+					m_Cells.push_back({ glm::dvec3(0.0), 0.0, 0.0, begin, split, 0, 0, c, uint32_t(level + 1) });
+				begin = split;
+			}
+			m_Cells[c].ChildCount = static_cast<uint32_t>(m_Cells.size()) - m_Cells[c].FirstChild;
+		}
+		m_LevelStarts.push_back(levelEnd);
+	}
+
+	// Near field coordinates are relative to the first body of their leaf, so they stay
+	// accurate in float however far the leaf is from the origin
+	m_BodyLeaf.resize(count);
+	pool.ParallelFor(0, m_Leaves.size(), 64, [&](size_t begin, size_t end)
+	{
+		for (size_t l = begin; l < end; l++)
+		{
+			const Cell& cell = m_Cells[m_Leaves[l]];
+			const glm::dvec3 origin = m_Positions[cell.Begin];
+			for (uint32_t k = cell.Begin; k < cell.End; k++)
+			{
+				m_BodyLeaf[k] = m_Leaves[l];
+				m_X[k] = static_cast<float>(m_Positions[k].x - origin.x);
+				m_Y[k] = static_cast<float>(m_Positions[k].y - origin.y);
+				m_Z[k] = static_cast<float>(m_Positions[k].z - origin.z);
+			}
+		}
+	});
+}
+
+void Fmm::MarkTargets(size_t bodies, const std::vector<uint32_t>* targets)
+{
+	m_Active.assign(m_Cells.size(), targets ? 0 : 1);
+	m_Wanted.assign(m_Positions.size(), targets ? 0 : 1);
+	if (!targets)
+		return;
+
+	m_Sorted.assign(bodies, NoCell);
+	for (size_t k = 0; k < m_Keys.size(); k++)
+		m_Sorted[m_Keys[k].second] = static_cast<uint32_t>(k);
+	for (uint32_t i : *targets)
+	{
+		uint32_t k = m_Sorted[i];
+		if (k == NoCell)
+			continue;
+		m_Wanted[k] = 1;
+		for (uint32_t c = m_BodyLeaf[k]; c != NoCell && !m_Active[c]; c = m_Cells[c].Parent)
+			m_Active[c] = 1;
+	}
+}
+
+double Fmm::GetCubeReach(const Cell& cell, const glm::dvec3& point) const
+{
+	// The cube is the Morton prefix its bodies share
+	int shift = KeyBits - int(cell.Level);
+	uint64_t key = m_Keys[cell.Begin].first;
+	glm::dvec3 corner(double(CompactBits(key) >> shift), double(CompactBits(key >> 1) >> shift), double(CompactBits(key >> 2) >> shift));
+	double side = double(uint64_t(1) << shift) * m_Quantum;
+	glm::dvec3 low = m_Origin + corner * side;
+	glm::dvec3 far = glm::max(point - low, low + side - point);
+	return glm::length(far);
+}
+
+void Fmm::Upward()
+{
+	// Children before parents: deepest level first, each level in parallel
+	const size_t terms = m_Terms.size();
+	for (size_t level = m_LevelStarts.size() - 1; level-- > 0; )
+	{
+		ThreadPool::Get().ParallelFor(m_LevelStarts[level], m_LevelStarts[level + 1], 16, [&](size_t begin, size_t end)
+		{
+			double monomials[MaxTerms];
+			for (size_t c = begin; c < end; c++)
+			{
+				Cell& cell = m_Cells[c];
+				double* multipole = &m_Multipoles[c * terms];
+				std::fill(multipole, multipole + terms, 0.0);
+				glm::dvec3 weighted(0.0);
+				cell.Mass = 0;
+				cell.Radius = 0;
+
+				if (cell.ChildCount == 0)
+				{
+					for (uint32_t k = cell.Begin; k < cell.End; k++)
+					{
+						cell.Mass += m_Masses[k];
+						weighted += m_Positions[k] * m_Masses[k];
+					}
+					cell.Center = weighted / cell.Mass;
+					for (uint32_t k = cell.Begin; k < cell.End; k++)
+					{
+						glm::dvec3 offset = m_Positions[k] - cell.Center;
+						cell.Radius = std::max(cell.Radius, glm::length(offset));
+						Monomials(offset, monomials);
+						for (size_t t = 0; t < terms; t++)
+							multipole[t] += m_Masses[k] * monomials[t];
+					}
+					continue;
+				}
+
+				for (uint32_t child = cell.FirstChild; child < cell.FirstChild + cell.ChildCount; child++)
+				{
+					cell.Mass += m_Cells[child].Mass;
+					weighted += m_Cells[child].Center * m_Cells[child].Mass;
+				}
+				cell.Center = weighted / cell.Mass;
+				cell.Radius = GetCubeReach(cell, cell.Center);
+				double childReach = 0;
+				for (uint32_t child = cell.FirstChild; child < cell.FirstChild + cell.ChildCount; child++)
+				{
+					// M2M: M_n += sum over k <= n of M_k (child) * d^(n - k) / (n - k)!
+					glm::dvec3 offset = m_Cells[child].Center - cell.Center;
+					childReach = std::max(childReach, glm::length(offset) + m_Cells[child].Radius);
+					Monomials(offset, monomials);
+					const double* source = &m_Multipoles[child * terms];
+					for (const Shift& shift : m_Shifts)
+						multipole[shift.High] += source[shift.Low] * monomials[shift.Difference];
+				}
+				// Either bound holds; the children's is tight for clustered bodies
+				cell.Radius = std::min(cell.Radius, childReach);
+			}
+		});
+	}
+}
+
+void Fmm::Interact(uint32_t target, uint32_t source, double theta2)
+{
+	if (!m_Active[target])
+		return;
+	const Cell& a = m_Cells[target];
+	const Cell& b = m_Cells[source];
+	glm::dvec3 d = a.Center - b.Center;
+	double reach = a.Radius + b.Radius;
+	if (target != source && reach * reach < theta2 * glm::dot(d, d))
+	{
+		m_FarLists[target].push_back(source);
+		return;
+	}
+	if (a.ChildCount == 0 && b.ChildCount == 0)
+	{
+		m_NearLists[target].push_back(source);
+		return;
+	}
+	// Open the larger of the two cells
+	if (b.ChildCount == 0 || (a.ChildCount != 0 && a.Radius > b.Radius))
+	{
+		for (uint32_t child = a.FirstChild; child < a.FirstChild + a.ChildCount; child++)
+			Interact(child, source, theta2);
+	}
+	else
+	{
+		for (uint32_t child = b.FirstChild; child < b.FirstChild + b.ChildCount; child++)
+			Interact(target, child, theta2);
+	}
+}
+
+void Fmm::Interactions(double theta2)
+{
+	for (size_t c = 0; c < m_Cells.size(); c++)
+	{
+		m_FarLists[c].clear();
+		m_NearLists[c].clear();
+	}
+
+	// A walk from (cell, root) only writes the lists of cell and its descendants, so
+	// walks from disjoint cells run in parallel. Tasks are the cells of the first level
+	// wide enough to keep the pool busy; interactions then start at that level.
+	std::vector<uint32_t> tasks(1, 0), next;
+	const size_t wanted = 16 * ThreadPool::Get().GetThreadCount();
+	while (tasks.size() < wanted)
+	{
+		next.clear();
+		for (uint32_t c : tasks)
+		{
+			if (m_Cells[c].ChildCount == 0)
+				next.push_back(c);
+			for (uint32_t child = m_Cells[c].FirstChild; child < m_Cells[c].FirstChild + m_Cells[c].ChildCount; child++)
+				next.push_back(child);
+		}
+		if (next.size() == tasks.size())
+			break;
+		tasks.swap(next);
+	}
+	ThreadPool::Get().ParallelFor(0, tasks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+			Interact(tasks[t], 0, theta2);
+	});
+
+	// M2L: L_k += sum over n of (-1)^|n| M_n D_(n + k)(a - b), with |n| + |k| <= order
+	const size_t terms = m_Terms.size();
+	ThreadPool::Get().ParallelFor(0, m_Cells.size(), 16, [&](size_t begin, size_t end)
+	{
+		double derivatives[MaxTerms], multipole[MaxTerms];
+		for (size_t c = begin; c < end; c++)
+		{
+			if (!m_Active[c])
+				continue;
+			double* local = &m_Locals[c * terms];
+			std::fill(local, local + terms, 0.0);
+			for (uint32_t source : m_FarLists[c])
+			{
+				Derivatives(m_Cells[c].Center - m_Cells[source].Center, derivatives);
+				const double* moments = &m_Multipoles[source * terms];
+				for (size_t n = 0; n < terms; n++)
+					multipole[n] = (m_Terms[n].Order & 1) ? -moments[n] : moments[n];
+				for (size_t k = 0; k < terms; k++)
+				{
+					const int* sums = &m_Sums[k * terms];
+					int count = m_OrderEnds[m_Order - m_Terms[k].Order];
+					double sum = 0;
+					for (int n = 0; n < count; n++)
+						sum += multipole[n] * derivatives[sums[n]];
+					local[k] += sum;
+				}
+			}
+		}
+	});
+}
+
+void Fmm::Downward(float softening2)
+{
+	// L2L, parents before children: L_m += sum over k >= m of L_k (parent) * e^(k - m) / (k - m)!
+	const size_t terms = m_Terms.size();
+	for (size_t level = 1; level + 1 < m_LevelStarts.size(); level++)
+	{
+		ThreadPool::Get().ParallelFor(m_LevelStarts[level], m_LevelStarts[level + 1], 64, [&](size_t begin, size_t end)
+		{
+			double monomials[MaxTerms];
+			for (size_t c = begin; c < end; c++)
+			{
+				if (!m_Active[c])
+					continue;
+				uint32_t parent = m_Cells[c].Parent;
+				Monomials(m_Cells[c].Center - m_Cells[parent].Center, monomials);
+				double* local = &m_Locals[c * terms];
+				const double* source = &m_Locals[parent * terms];
+				for (const Shift& shift : m_Shifts)
+					local[shift.Low] += source[shift.High] * monomials[shift.Difference];
+			}
+		});
+	}
+
+	// L2P plus the direct near field
+	m_Accelerations.resize(m_Positions.size());
+	ThreadPool::Get().ParallelFor(0, m_Leaves.size(), 4, [&](size_t begin, size_t end)
+	{
+		double monomials[MaxTerms];
+		for (size_t l = begin; l < end; l++)
+		{
+			uint32_t c = m_Leaves[l];
+			if (!m_Active[c])
+				continue;
+			const Cell& cell = m_Cells[c];
+			const double* local = &m_Locals[c * terms];
+			for (uint32_t i = cell.Begin; i < cell.End; i++)
+			{
+				if (!m_Wanted[i])
+					continue;
+				// The gradient of sum L_k t^k / k! along axis a is sum L_(m + e_a) t^m / m!
+				Monomials(m_Positions[i] - cell.Center, monomials);
+				glm::dvec3 acceleration(0.0);
+				for (size_t t = 0; t < terms; t++)
+					for (int axis = 0; axis < 3; axis++)
+						if (m_Terms[t].Up[axis] >= 0)
+							acceleration[axis] += local[m_Terms[t].Up[axis]] * monomials[t];
+				acceleration *= G;
+
+				// Single precision like the SIMD kernel, in a loop the compiler vectorizes;
+				// the body itself has d = 0 and adds nothing. The leaf origins are apart by
+				// less than the near field reaches, so their offset is exact enough in float.
+				const glm::dvec3& origin = m_Positions[cell.Begin];
+				for (uint32_t source : m_NearLists[c])
+				{
+					const glm::dvec3& sourceOrigin = m_Positions[m_Cells[source].Begin];
+					const float x = m_X[i] - static_cast<float>(sourceOrigin.x - origin.x);
+					const float y = m_Y[i] - static_cast<float>(sourceOrigin.y - origin.y);
+					const float z = m_Z[i] - static_cast<float>(sourceOrigin.z - origin.z);
+					float ax = 0, ay = 0, az = 0;
+					for (uint32_t j = m_Cells[source].Begin; j < m_Cells[source].End; j++)
+					{
+						float dx = m_X[j] - x, dy = m_Y[j] - y, dz = m_Z[j] - z;
+						float r2 = dx * dx + dy * dy + dz * dz + softening2;
+						float s = r2 > 0 ? m_GM[j] / (r2 * sqrtf(r2)) : 0.0f;
+						ax += dx * s;
+						ay += dy * s;
+						az += dz * s;
+					}
+					acceleration += glm::dvec3(ax, ay, az);
+				}
+				m_Accelerations[i] = acceleration;
+			}
+		}
+	});
+}
+
+void Fmm::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, std::vector<glm::vec3>& accelerations)
+{
+	accelerations.assign(positions.size(), glm::vec3(0.0f));
+	Compute(positions, masses, order, theta, softening, nullptr, accelerations);
+}
+
+void Fmm::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations)
+{
+	accelerations.resize(positions.size());
+	// Massless targets are not in the tree and stay at zero
+	for (uint32_t i : targets)
+		accelerations[i] = glm::vec3(0.0f);
+	Compute(positions, masses, order, theta, softening, &targets, accelerations);
+}
+
+void Fmm::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations)
+{
+	SetOrder(order);
+	Build(positions, masses);
+	if (m_Cells.empty())
+		return;
+
+	const size_t terms = m_Terms.size();
+	m_Multipoles.resize(m_Cells.size() * terms);
+	m_Locals.resize(m_Cells.size() * terms);
+	if (m_FarLists.size() < m_Cells.size())
+	{
+		m_FarLists.resize(m_Cells.size());
+		m_NearLists.resize(m_Cells.size());
+	}
+
+	double clamped = std::min(theta, MaxTheta);
+	MarkTargets(positions.size(), targets);
+	Upward();
+	Interactions(clamped * clamped);
+	Downward(softening * softening);
+
+	if (targets)
+	{
+		for (uint32_t i : *targets)
+			if (m_Sorted[i] != NoCell)
+				accelerations[i] = glm::vec3(m_Accelerations[m_Sorted[i]]);
+		return;
+	}
+	ThreadPool::Get().ParallelFor(0, m_Keys.size(), 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t k = begin; k < end; k++)
+			accelerations[m_Keys[k].second] = glm::vec3(m_Accelerations[k]);
+	});
+}
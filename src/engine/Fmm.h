@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Cartesian fast multipole method.
+// Bodies are sorted along a Morton curve into an adaptive octree whose leaves hold at
+// most LeafSize bodies. The upward pass gives every cell a multipole expansion about
+// its centre of mass; a dual tree walk then lists, per target cell, the source cells
+// far enough away to act through their expansions (turned into a local Taylor series
+// of the target) and the leaves close enough to need direct sums; the downward pass
+// shifts the local series to the leaves and evaluates them at the bodies. Each pass is
+// parallel, and for a fixed order and opening angle the cost grows linearly with N.
+class Fmm
+{
+public:
+	// Cells A and B interact through their expansions when
+	// (radius A + radius B) < theta * distance; theta is capped below 1, where the
+	// series stop converging. Softening only applies to the direct near field.
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, std::vector<glm::vec3>& accelerations);
+	// Only writes the entries listed in targets. The tree and the multipoles still cover
+	// every body; the local expansions and near fields only serve the targets' leaves.
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations);
+
+	size_t GetCellCount() const { return m_Cells.size(); }
+
+	static constexpr int MaxOrder = 8;
+	static constexpr uint32_t LeafSize = 32;
+	static constexpr float MaxTheta = 0.9f;
+private:
+	struct Cell
+	{
+		glm::dvec3 Center; // centre of mass, the expansion centre
+		double Radius;	   // every body is within this distance of Center
+		double Mass;
+		uint32_t Begin, End; // range of sorted bodies
+		uint32_t FirstChild, ChildCount;
+		uint32_t Parent;
+		uint32_t Level;
+	};
+
+	// Multi-index tables for one expansion order
+	struct Term
+	{
+		int N[3];
+		int Order;
+		int Down[3];	 // index of N - e_i, -1 if N_i == 0
+		int DownTwo[3];	 // index of N - 2 e_i, -1 if N_i < 2
+		int Up[3];		 // index of N + e_i, -1 beyond the order
+	};
+	struct Shift
+	{
+		int Low, High, Difference; // Low <= High component-wise, Difference = High - Low
+	};
+
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, int order, float theta, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations);
+	void SetOrder(int order);
+	int GetIndex(int x, int y, int z) const;
+	// x^n / n! for every term
+	void Monomials(const glm::dvec3& x, double* out) const;
+	// Derivatives of 1/|r| for every term
+	void Derivatives(const glm::dvec3& r, double* out) const;
+
+	void Build(const std::vector<Vec3>& positions, const std::vector<double>& masses);
+	// Flags the leaves holding targets and their ancestors, every cell without targets
+	void MarkTargets(size_t bodies, const std::vector<uint32_t>* targets);
+	// Largest distance from point to the octree cube of cell
+	double GetCubeReach(const Cell& cell, const glm::dvec3& point) const;
+	void Upward();
+	void Interact(uint32_t target, uint32_t source, double theta2);
+	void Interactions(double theta2);
+	void Downward(float softening2);
+
+	int m_Order = 0;
+	std::vector<Term> m_Terms;
+	std::vector<int> m_Lookup;
+	std::vector<Shift> m_Shifts;
+	std::vector<int> m_Sums;	  // [k * terms + n]: index of n + k
+	std::vector<int> m_OrderEnds; // number of terms up to each total order
+
+	std::vector<std::pair<uint64_t, uint32_t>> m_Keys; // Morton key, body
+	glm::dvec3 m_Origin;
+	double m_Quantum; // key cube edge
+	std::vector<glm::dvec3> m_Positions; // sorted
+	std::vector<double> m_Masses;
+	std::vector<float> m_X, m_Y, m_Z, m_GM; // sorted copy for the near field, leaf relative
+	std::vector<glm::dvec3> m_Accelerations;
+
+	std::vector<Cell> m_Cells; // breadth first, so levels are contiguous
+	std::vector<uint32_t> m_LevelStarts;
+	std::vector<uint32_t> m_Leaves;
+	std::vector<uint32_t> m_BodyLeaf; // leaf cell of each sorted body
+	std::vector<uint8_t> m_Active;	  // per cell: its local expansion is needed
+	std::vector<uint8_t> m_Wanted;	  // per sorted body: its acceleration is needed
+	std::vector<uint32_t> m_Sorted;	  // sorted index of each input body, UINT32_MAX if massless
+	std::vector<double> m_Multipoles; // m_Terms.size() per cell
+	std::vector<double> m_Locals;
+	std::vector<std::vector<uint32_t>> m_FarLists;	// per target cell
+	std::vector<std::vector<uint32_t>> m_NearLists;	// per target leaf
+};
@@ -0,0 +1,164 @@
+#include "ForceKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../utils/ThreadPool.h"
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+
+void ComputeForcesScalar(const ForceKernelArrays& data, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		float ax = 0, ay = 0, az = 0;
+		for (size_t j = 0; j < data.Padded; j++)
+		{
+			float dx = data.X[j] - data.TX[i];
+			float dy = data.Y[j] - data.TY[i];
+			float dz = data.Z[j] - data.TZ[i];
+			float r2 = dx * dx + dy * dy + dz * dz + data.Softening2;
+			if (r2 <= 0)
+				continue;
+			float invR = 1.0f / sqrtf(r2);
+			float s = data.GM[j] * invR * invR * invR;
+			ax += dx * s;
+			ay += dy * s;
+			az += dz * s;
+		}
+		data.AX[i] = ax;
+		data.AY[i] = ay;
+		data.AZ[i] = az;
+	}
+}
+
+ForceKernel::ForceKernel()
+	: m_Level(GetSupportedLevel())
+{
+}
+
+SimdLevel ForceKernel::GetSupportedLevel()
+{
+	SimdLevel level = DetectSimdLevel();
+	if (level == SimdLevel::AVX512 && !HasForcesAVX512())
+		level = SimdLevel::AVX2;
+	if (level == SimdLevel::AVX2 && !HasForcesAVX2())
+		level = SimdLevel::Scalar;
+	return level;
+}
+
+void ForceKernel::SetLevel(SimdLevel level)
+{
+	m_Level = std::min(level, GetSupportedLevel());
+}
+
+void ForceKernel::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, std::vector<glm::vec3>& accelerations)
+{
+	Pack(positions, masses, softening);
+	ThreadPool::Get().ParallelFor(0, m_Data.PaddedTargets, 4 * ForceKernelData::Width, [this](size_t begin, size_t end)
+	{
+		ComputeRange(begin, end);
+	});
+	Unpack(masses, accelerations);
+}
+
+void ForceKernel::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations)
+{
+	Pack(positions, masses, softening);
+	PackTargets(targets);
+	ThreadPool::Get().ParallelFor(0, m_Data.PaddedTargets, 4 * ForceKernelData::Width, [this](size_t begin, size_t end)
+	{
+		ComputeRange(begin, end);
+	});
+	Unpack(masses, accelerations);
+}
+
+void ForceKernel::Pack(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening)
+{
+	size_t count = positions.size();
+	size_t padded = (count + ForceKernelData::Width - 1) / ForceKernelData::Width * ForceKernelData::Width;
+	m_Data.Count = count;
+	m_Data.Padded = padded;
+	m_Data.Softening2 = softening * softening;
+	m_Data.Subset = false;
+	m_Data.Targets.clear();
+	m_Data.PaddedTargets = padded;
+
+	m_Data.X.assign(padded, 0.0f);
+	m_Data.Y.assign(padded, 0.0f);
+	m_Data.Z.assign(padded, 0.0f);
+	m_Data.GM.assign(padded, 0.0f);
+	m_Data.AX.resize(padded);
+	m_Data.AY.resize(padded);
+	m_Data.AZ.resize(padded);
+	if (count == 0)
+		return;
+
+	Vec3 minBound = positions[0], maxBound = positions[0];
+	for (size_t i = 1; i < count; i++)
+	{
+		minBound = glm::min(minBound, positions[i]);
+		maxBound = glm::max(maxBound, positions[i]);
+	}
+	const Vec3 origin = (minBound + maxBound) / Real(2);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_Data.X[i] = static_cast<float>(positions[i].x - origin.x);
+		m_Data.Y[i] = static_cast<float>(positions[i].y - origin.y);
+		m_Data.Z[i] = static_cast<float>(positions[i].z - origin.z);
+		m_Data.GM[i] = static_cast<float>(G * masses[i]);
+	}
+}
+
+void ForceKernel::PackTargets(const std::vector<uint32_t>& targets)
+{
+	// Copies of the packed source entries, so a target still meets itself at r = 0
+	size_t padded = (targets.size() + ForceKernelData::Width - 1) / ForceKernelData::Width * ForceKernelData::Width;
+	m_Data.Subset = true;
+	m_Data.Targets = targets;
+	m_Data.PaddedTargets = padded;
+	m_Data.TX.assign(padded, 0.0f);
+	m_Data.TY.assign(padded, 0.0f);
+	m_Data.TZ.assign(padded, 0.0f);
+	m_Data.AX.resize(padded);
+	m_Data.AY.resize(padded);
+	m_Data.AZ.resize(padded);
+	for (size_t k = 0; k < targets.size(); k++)
+	{
+		m_Data.TX[k] = m_Data.X[targets[k]];
+		m_Data.TY[k] = m_Data.Y[targets[k]];
+		m_Data.TZ[k] = m_Data.Z[targets[k]];
+	}
+}
+
+void ForceKernel::ComputeRange(size_t begin, size_t end)
+{
+	ForceKernelArrays arrays = m_Data.GetArrays();
+	switch (m_Level)
+	{
+	case SimdLevel::AVX512:
+		ComputeForcesAVX512(arrays, begin, end);
+		break;
+	case SimdLevel::AVX2:
+		ComputeForcesAVX2(arrays, begin, end);
+		break;
+	default:
+		ComputeForcesScalar(arrays, begin, end);
+		break;
+	}
+}
+
+void ForceKernel::Unpack(const std::vector<double>& masses, std::vector<glm::vec3>& accelerations) const
+{
+	accelerations.resize(m_Data.Count);
+	size_t targets = m_Data.Subset ? m_Data.Targets.size() : m_Data.Count;
+	for (size_t k = 0; k < targets; k++)
+	{
+		size_t i = m_Data.Subset ? m_Data.Targets[k] : k;
+		// Massless bodies are not accelerated, matching the reference solver
+		if (masses[i] == 0)
+			accelerations[i] = glm::vec3(0.0f);
+		else
+			accelerations[i] = glm::vec3(m_Data.AX[k], m_Data.AY[k], m_Data.AZ[k]);
+	}
+}
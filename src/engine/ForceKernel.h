@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+#include "ForceKernelArrays.h"
+#include "../utils/Cpu.h"
+
+// Packed single-precision inputs and outputs of the all-pairs kernels.
+// Positions are relative to the centre of their bounds, which keeps the float
+// differences the kernels take as exact as the range allows. Arrays are padded
+// with massless entries to a multiple of ForceKernelData::Width.
+struct ForceKernelData
+{
+	static constexpr size_t Width = 16;
+
+	std::vector<float> X, Y, Z, GM;
+	std::vector<float> AX, AY, AZ; // per target
+	float Softening2 = 0.0f; // squared Plummer softening length
+	size_t Count = 0;
+	size_t Padded = 0;
+
+	// A subset of the bodies as targets, packed the same way; every body is a target otherwise
+	bool Subset = false;
+	std::vector<float> TX, TY, TZ;
+	std::vector<uint32_t> Targets;
+	size_t PaddedTargets = 0;
+
+	// Valid until the arrays are resized
+	ForceKernelArrays GetArrays()
+	{
+		const float* tx = Subset ? TX.data() : X.data();
+		const float* ty = Subset ? TY.data() : Y.data();
+		const float* tz = Subset ? TZ.data() : Z.data();
+		return { X.data(), Y.data(), Z.data(), GM.data(), tx, ty, tz, AX.data(), AY.data(), AZ.data(), Padded, Softening2 };
+	}
+};
+
+// Direct summation with the widest SIMD path available at runtime
+class ForceKernel
+{
+public:
+	ForceKernel();
+
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, std::vector<glm::vec3>& accelerations);
+	// Only writes the entries listed in targets; every body still acts as a source
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations);
+
+	void Pack(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening);
+	// After Pack: limits ComputeRange and Unpack to these bodies
+	void PackTargets(const std::vector<uint32_t>& targets);
+	void ComputeRange(size_t begin, size_t end);
+	void Unpack(const std::vector<double>& masses, std::vector<glm::vec3>& accelerations) const;
+
+	void SetLevel(SimdLevel level);
+	SimdLevel GetLevel() const { return m_Level; }
+	const ForceKernelData& GetData() const { return m_Data; }
+
+	// Best level that the CPU supports and this build was compiled for
+	static SimdLevel GetSupportedLevel();
+private:
+	SimdLevel m_Level;
+	ForceKernelData m_Data;
+};
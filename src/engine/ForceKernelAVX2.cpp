@@ -0,0 +1,61 @@
+#include "ForceKernelArrays.h"
+
+// This file is compiled with AVX2/FMA enabled; it is only called after a CPUID check
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+bool HasForcesAVX2()
+{
+	return true;
+}
+
+void ComputeForcesAVX2(const ForceKernelArrays& data, size_t begin, size_t end)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 threeHalves = _mm256_set1_ps(1.5f);
+	const __m256 softening2 = _mm256_set1_ps(data.Softening2);
+
+	for (size_t i = begin; i < end; i += 8)
+	{
+		__m256 xi = _mm256_loadu_ps(data.TX + i);
+		__m256 yi = _mm256_loadu_ps(data.TY + i);
+		__m256 zi = _mm256_loadu_ps(data.TZ + i);
+		__m256 ax = zero, ay = zero, az = zero;
+
+		for (size_t j = 0; j < data.Padded; j++)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_broadcast_ss(data.X + j), xi);
+			__m256 dy = _mm256_sub_ps(_mm256_broadcast_ss(data.Y + j), yi);
+			__m256 dz = _mm256_sub_ps(_mm256_broadcast_ss(data.Z + j), zi);
+			__m256 r2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dx, dx, softening2)));
+
+			// rsqrt estimate refined with one Newton-Raphson step
+			__m256 invR = _mm256_rsqrt_ps(r2);
+			invR = _mm256_mul_ps(invR, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(invR, invR), threeHalves));
+			__m256 invR3 = _mm256_mul_ps(_mm256_mul_ps(invR, invR), invR);
+
+			// Self-interaction (r2 == 0) would be inf * 0, mask it out
+			__m256 s = _mm256_mul_ps(_mm256_broadcast_ss(data.GM + j), invR3);
+			s = _mm256_and_ps(s, _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+
+			ax = _mm256_fmadd_ps(dx, s, ax);
+			ay = _mm256_fmadd_ps(dy, s, ay);
+			az = _mm256_fmadd_ps(dz, s, az);
+		}
+		_mm256_storeu_ps(data.AX + i, ax);
+		_mm256_storeu_ps(data.AY + i, ay);
+		_mm256_storeu_ps(data.AZ + i, az);
+	}
+}
+#else
+bool HasForcesAVX2()
+{
+	return false;
+}
+
+void ComputeForcesAVX2(const ForceKernelArrays& data, size_t begin, size_t end)
+{
+	ComputeForcesScalar(data, begin, end);
+}
+#endif
@@ -0,0 +1,61 @@
+#include "ForceKernelArrays.h"
+
+// This file is compiled with AVX-512F enabled; it is only called after a CPUID check
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+bool HasForcesAVX512()
+{
+	return true;
+}
+
+void ComputeForcesAVX512(const ForceKernelArrays& data, size_t begin, size_t end)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 half = _mm512_set1_ps(0.5f);
+	const __m512 threeHalves = _mm512_set1_ps(1.5f);
+	const __m512 softening2 = _mm512_set1_ps(data.Softening2);
+
+	for (size_t i = begin; i < end; i += 16)
+	{
+		__m512 xi = _mm512_loadu_ps(data.TX + i);
+		__m512 yi = _mm512_loadu_ps(data.TY + i);
+		__m512 zi = _mm512_loadu_ps(data.TZ + i);
+		__m512 ax = zero, ay = zero, az = zero;
+
+		for (size_t j = 0; j < data.Padded; j++)
+		{
+			__m512 dx = _mm512_sub_ps(_mm512_set1_ps(data.X[j]), xi);
+			__m512 dy = _mm512_sub_ps(_mm512_set1_ps(data.Y[j]), yi);
+			__m512 dz = _mm512_sub_ps(_mm512_set1_ps(data.Z[j]), zi);
+			__m512 r2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_fmadd_ps(dx, dx, softening2)));
+
+			// rsqrt14 estimate refined with one Newton-Raphson step
+			__m512 invR = _mm512_rsqrt14_ps(r2);
+			invR = _mm512_mul_ps(invR, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(invR, invR), threeHalves));
+			__m512 invR3 = _mm512_mul_ps(_mm512_mul_ps(invR, invR), invR);
+
+			// Self-interaction (r2 == 0) is masked out instead of producing inf * 0
+			__mmask16 valid = _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ);
+			__m512 s = _mm512_maskz_mul_ps(valid, _mm512_set1_ps(data.GM[j]), invR3);
+
+			ax = _mm512_fmadd_ps(dx, s, ax);
+			ay = _mm512_fmadd_ps(dy, s, ay);
+			az = _mm512_fmadd_ps(dz, s, az);
+		}
+		_mm512_storeu_ps(data.AX + i, ax);
+		_mm512_storeu_ps(data.AY + i, ay);
+		_mm512_storeu_ps(data.AZ + i, az);
+	}
+}
+#else
+bool HasForcesAVX512()
+{
+	return false;
+}
+
+void ComputeForcesAVX512(const ForceKernelArrays& data, size_t begin, size_t end)
+{
+	ComputeForcesAVX2(data, begin, end);
+}
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+
+// Raw view of ForceKernelData handed to the kernels. ForceKernelAVX2.cpp and
+// ForceKernelAVX512.cpp are built with extra ISA flags and include nothing but
+// this header: any inline STL or glm code instantiated there would be compiled
+// for that ISA, and the linker may keep that copy for every caller.
+struct ForceKernelArrays
+{
+	const float* X;
+	const float* Y;
+	const float* Z;
+	const float* GM;
+	const float* TX; // target positions, the source arrays themselves for a full solve
+	const float* TY;
+	const float* TZ;
+	float* AX;
+	float* AY;
+	float* AZ;
+	size_t Padded;
+	float Softening2;
+};
+
+// Each kernel fills AX/AY/AZ for targets [begin, end) against every source.
+// begin and end must be multiples of ForceKernelData::Width (or the padded end).
+void ComputeForcesScalar(const ForceKernelArrays& data, size_t begin, size_t end);
+void ComputeForcesAVX2(const ForceKernelArrays& data, size_t begin, size_t end);
+void ComputeForcesAVX512(const ForceKernelArrays& data, size_t begin, size_t end);
+bool HasForcesAVX2();
+bool HasForcesAVX512();
@@ -0,0 +1,165 @@
+#include "GpuNBody.h"
+
+#include <vector>
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+
+GpuNBody::GpuNBody()
+	: m_ForceShader("assets/shaders/nbody-force-comp.glsl"), m_DriftShader("assets/shaders/nbody-drift-comp.glsl")
+{
+}
+
+void GpuNBody::Allocate(size_t capacity)
+{
+	Destroy();
+	m_Capacity = capacity;
+	GLsizeiptr size = GLsizeiptr(capacity * sizeof(glm::vec4));
+
+	GLuint* buffers[] = { &m_Positions, &m_Velocities, &m_Accelerations };
+	for (GLuint* buffer : buffers)
+	{
+		glCreateBuffers(1, buffer);
+		glNamedBufferStorage(*buffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &m_Readback);
+	glNamedBufferStorage(m_Readback, size * 2, nullptr, flags);
+	m_ReadbackData = static_cast<glm::vec4*>(glMapNamedBufferRange(m_Readback, 0, size * 2, flags));
+}
+
+void GpuNBody::Upload(const ParticleSystem& particles)
+{
+	m_Count = particles.Size();
+	if (m_Count > m_Capacity || m_Positions == 0)
+		Allocate(m_Count > 64 ? m_Count * 2 : 128);
+
+	std::vector<glm::vec4> positions(m_Count), velocities(m_Count);
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		positions[i] = glm::vec4(glm::vec3(particles.Positions[i]), float(G * particles.Masses[i]));
+		velocities[i] = glm::vec4(glm::vec3(particles.Velocities[i]), 0.0f);
+	}
+	if (m_Count > 0)
+	{
+		glNamedBufferSubData(m_Positions, 0, GLsizeiptr(m_Count * sizeof(glm::vec4)), positions.data());
+		glNamedBufferSubData(m_Velocities, 0, GLsizeiptr(m_Count * sizeof(glm::vec4)), velocities.data());
+	}
+
+	// Leapfrog opens with a half kick from the current accelerations
+	ComputeForces(0.0f);
+	m_Dirty = false;
+}
+
+void GpuNBody::ComputeForces(float halfStep)
+{
+	if (m_Count == 0)
+		return;
+	m_ForceShader.Activate();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Positions);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_Velocities);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_Accelerations);
+	m_ForceShader.SetInt("uCount", GLint(m_Count));
+	m_ForceShader.SetFloat("uHalfStep", halfStep);
+	m_ForceShader.SetFloat("uSoftening2", m_Softening * m_Softening);
+	glDispatchCompute(GLuint((m_Count + WorkgroupSize - 1) / WorkgroupSize), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuNBody::Step(ParticleSystem& particles, float dt, const GravitySettings& settings)
+{
+	bool softeningChanged = settings.Softening != m_Softening;
+	m_Softening = settings.Softening;
+	if (m_Dirty || particles.Size() != m_Count)
+		Upload(particles);
+	else if (softeningChanged)
+		ComputeForces(0.0f); // the opening half kick has to see the new forces too
+	if (m_Count == 0)
+		return;
+
+	// Kick and drift with last step's accelerations
+	m_DriftShader.Activate();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_Positions);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_Velocities);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_Accelerations);
+	m_DriftShader.SetInt("uCount", GLint(m_Count));
+	m_DriftShader.SetFloat("uHalfStep", dt * 0.5f);
+	m_DriftShader.SetFloat("uStep", dt);
+	glDispatchCompute(GLuint((m_Count + WorkgroupSize - 1) / WorkgroupSize), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// New accelerations and the closing half kick
+	ComputeForces(dt * 0.5f);
+}
+
+void GpuNBody::Invalidate()
+{
+	m_Dirty = true;
+	// A copy queued before the edit would overwrite it
+	if (m_ReadbackFence)
+	{
+		glDeleteSync(m_ReadbackFence);
+		m_ReadbackFence = nullptr;
+	}
+}
+
+void GpuNBody::Sync(ParticleSystem& particles)
+{
+	if (m_Dirty || m_Count == 0)
+		return;
+
+	if (m_ReadbackFence)
+	{
+		GLenum result = glClientWaitSync(m_ReadbackFence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+			return;
+		glDeleteSync(m_ReadbackFence);
+		m_ReadbackFence = nullptr;
+		if (result != GL_WAIT_FAILED && particles.Size() == m_Count)
+		{
+			for (size_t i = 0; i < m_Count; i++)
+			{
+				particles.Positions[i] = Vec3(glm::vec3(m_ReadbackData[i]));
+				particles.Velocities[i] = Vec3(glm::vec3(m_ReadbackData[m_Capacity + i]));
+			}
+		}
+	}
+
+	GLsizeiptr size = GLsizeiptr(m_Count * sizeof(glm::vec4));
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(m_Positions, m_Readback, 0, 0, size);
+	glCopyNamedBufferSubData(m_Velocities, m_Readback, 0, GLintptr(m_Capacity * sizeof(glm::vec4)), size);
+	m_ReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GpuNBody::Download(ParticleSystem& particles)
+{
+	if (m_Dirty || m_Count == 0 || particles.Size() != m_Count)
+		return;
+
+	std::vector<glm::vec4> data(m_Count);
+	GLsizeiptr size = GLsizeiptr(m_Count * sizeof(glm::vec4));
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(m_Positions, 0, size, data.data());
+	for (size_t i = 0; i < m_Count; i++)
+		particles.Positions[i] = Vec3(glm::vec3(data[i]));
+	glGetNamedBufferSubData(m_Velocities, 0, size, data.data());
+	for (size_t i = 0; i < m_Count; i++)
+		particles.Velocities[i] = Vec3(glm::vec3(data[i]));
+}
+
+void GpuNBody::Destroy()
+{
+	if (m_ReadbackFence)
+		glDeleteSync(m_ReadbackFence);
+	m_ReadbackFence = nullptr;
+	if (m_Positions == 0)
+		return;
+	// Deleting the readback buffer unmaps it
+	GLuint buffers[] = { m_Positions, m_Velocities, m_Accelerations, m_Readback };
+	glDeleteBuffers(4, buffers);
+	m_Positions = m_Velocities = m_Accelerations = m_Readback = 0;
+	m_ReadbackData = nullptr;
+	m_Capacity = 0;
+	m_Dirty = true;
+}
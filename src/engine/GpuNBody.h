@@ -0,0 +1,52 @@
+#pragma once
+#include <glad/glad.h>
+
+#include "Simulation.h"
+#include "../renderer/Shader.h"
+
+// All-pairs gravity and leapfrog (kick-drift-kick) integration in compute shaders.
+// Positions (xyz, w = G * mass) and velocities live in shader storage buffers that
+// the body and grid shaders read directly; the CPU copy in ParticleSystem is
+// refreshed asynchronously, one frame behind, for the UI, camera and trajectories.
+// The GPU state is single precision whatever Real is.
+class GpuNBody : public SimulationBackend
+{
+public:
+	GpuNBody();
+
+	// Only the softening of settings applies, forces are always summed directly
+	void Step(ParticleSystem& particles, float dt, const GravitySettings& settings) override;
+	void Invalidate() override;
+
+	// Copies the state finished by an earlier frame into particles without waiting,
+	// then queues a copy of the current state. Call once per frame.
+	void Sync(ParticleSystem& particles);
+	// Blocking readback, used when handing the state back to the CPU path
+	void Download(ParticleSystem& particles);
+
+	GLuint GetPositionBuffer() const { return m_Positions; }
+	size_t GetCount() const { return m_Count; }
+	void Destroy();
+
+	static const int WorkgroupSize = 256; // must match local_size_x in the nbody shaders
+private:
+	void Upload(const ParticleSystem& particles);
+	void Allocate(size_t capacity);
+	void ComputeForces(float halfStep);
+
+	Shader m_ForceShader;
+	Shader m_DriftShader;
+
+	GLuint m_Positions = 0;
+	GLuint m_Velocities = 0;
+	GLuint m_Accelerations = 0;
+	// Persistently mapped copy target for Sync, positions followed by velocities
+	GLuint m_Readback = 0;
+	glm::vec4* m_ReadbackData = nullptr;
+	GLsync m_ReadbackFence = nullptr;
+
+	size_t m_Count = 0;
+	size_t m_Capacity = 0;
+	float m_Softening = 0.0f;
+	bool m_Dirty = true;
+};
@@ -0,0 +1,118 @@
+#include "Gravity.h"
+
+#include <cmath>
+
+#include "../utils/ThreadPool.h"
+#include "../utils/Profiler.h"
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+
+void Gravity::ComputeAccelerations(const ParticleSystem& particles, const GravitySettings& settings, std::vector<glm::vec3>& accelerations)
+{
+	ComputeAccelerations(particles.Positions, particles.Masses, settings, accelerations);
+}
+
+void Gravity::ComputeAccelerations(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, std::vector<glm::vec3>& accelerations)
+{
+	accelerations.assign(positions.size(), glm::vec3(0.0f));
+	Compute(positions, masses, settings, nullptr, accelerations);
+}
+
+void Gravity::ComputeAccelerations(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations)
+{
+	accelerations.resize(positions.size());
+	Compute(positions, masses, settings, &targets, accelerations);
+}
+
+void Gravity::Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations)
+{
+	PROFILE_SCOPE("Gravity");
+	switch (settings.Solver)
+	{
+	case GravitySolver::Direct:
+		ComputeDirect(positions, masses, settings.Softening, targets, accelerations);
+		break;
+	case GravitySolver::DirectSimd:
+		if (targets)
+			m_Kernel.Compute(positions, masses, settings.Softening, *targets, accelerations);
+		else
+			m_Kernel.Compute(positions, masses, settings.Softening, accelerations);
+		break;
+	case GravitySolver::Fmm:
+		if (targets)
+			m_Fmm.Compute(positions, masses, settings.FmmOrder, settings.Theta, settings.Softening, *targets, accelerations);
+		else
+			m_Fmm.Compute(positions, masses, settings.FmmOrder, settings.Theta, settings.Softening, accelerations);
+		break;
+	default:
+		ComputeBarnesHut(positions, masses, settings.Theta, settings.Softening, targets, accelerations);
+		break;
+	}
+}
+
+void Gravity::ComputeDirect(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations)
+{
+	const double softening2 = double(softening) * softening;
+	size_t count = targets ? targets->size() : positions.size();
+	ThreadPool::Get().ParallelFor(0, count, 64, [&](size_t begin, size_t end)
+	{
+		for (size_t k = begin; k < end; k++)
+		{
+			size_t i = targets ? (*targets)[k] : k;
+			if (masses[i] == 0)
+			{
+				accelerations[i] = glm::vec3(0.0f);
+				continue;
+			}
+			glm::dvec3 acceleration(0.0);
+			for (size_t j = 0; j < positions.size(); j++)
+			{
+				if (i == j)
+					continue;
+				glm::dvec3 d = glm::dvec3(positions[j]) - glm::dvec3(positions[i]);
+				double dist2 = glm::dot(d, d) + softening2;
+				if (dist2 > 0)
+					acceleration += d * (G * masses[j] / (dist2 * sqrt(dist2)));
+			}
+			accelerations[i] = glm::vec3(acceleration);
+		}
+	});
+}
+
+void Gravity::ComputeBarnesHut(const std::vector<Vec3>& positions, const std::vector<double>& masses, float theta, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations)
+{
+	m_Octree.Build(positions, masses);
+	size_t count = targets ? targets->size() : positions.size();
+	ThreadPool::Get().ParallelFor(0, count, 256, [&](size_t begin, size_t end)
+	{
+		for (size_t k = begin; k < end; k++)
+		{
+			size_t i = targets ? (*targets)[k] : k;
+			if (masses[i] != 0)
+				accelerations[i] = m_Octree.GetAcceleration(positions[i], static_cast<int>(i), theta, softening);
+			else
+				accelerations[i] = glm::vec3(0.0f);
+		}
+	});
+}
+
+float Gravity::MeasureError(const ParticleSystem& particles, const GravitySettings& settings)
+{
+	std::vector<glm::vec3> approx, exact;
+	ComputeAccelerations(particles, settings, approx);
+	GravitySettings reference = settings;
+	reference.Solver = GravitySolver::Direct;
+	ComputeAccelerations(particles, reference, exact);
+
+	double sum = 0;
+	int count = 0;
+	for (size_t i = 0; i < exact.size(); i++)
+	{
+		double magnitude = glm::length(glm::dvec3(exact[i]));
+		if (magnitude == 0)
+			continue;
+		sum += pow(glm::length(glm::dvec3(approx[i] - exact[i])) / magnitude, 2);
+		count++;
+	}
+	return count > 0 ? static_cast<float>(sqrt(sum / count)) : 0.0f;
+}
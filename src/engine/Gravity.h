@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "ParticleSystem.h"
+#include "Octree.h"
+#include "ForceKernel.h"
+#include "Fmm.h"
+
+enum class GravitySolver
+{
+	Direct,		// O(N^2) pairwise summation, kept as the accuracy reference
+	BarnesHut,	// O(N log N) octree approximation
+	DirectSimd,	// O(N^2) single precision, vectorized with the best SIMD path at runtime
+	Fmm			// O(N) fast multipole method
+};
+
+struct GravitySettings
+{
+	GravitySolver Solver = GravitySolver::BarnesHut;
+	float Theta = 0.5f;		// Barnes-Hut opening angle, 0 opens every cell
+	float Softening = 0.0f; // Plummer length: forces go as r / (r^2 + eps^2)^1.5, 0 is exact Newton
+	int FmmOrder = 4;		// FMM expansion order, error falls roughly as theta^(order + 1)
+};
+
+// Computes the gravitational acceleration acting on every body
+class Gravity
+{
+public:
+	void ComputeAccelerations(const ParticleSystem& particles, const GravitySettings& settings, std::vector<glm::vec3>& accelerations);
+	void ComputeAccelerations(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, std::vector<glm::vec3>& accelerations);
+	// Only writes the entries listed in targets; every body still acts as a source
+	void ComputeAccelerations(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, const std::vector<uint32_t>& targets, std::vector<glm::vec3>& accelerations);
+	// RMS relative error of the configured solver against direct summation
+	float MeasureError(const ParticleSystem& particles, const GravitySettings& settings);
+
+	ForceKernel& GetKernel() { return m_Kernel; }
+
+private:
+	void Compute(const std::vector<Vec3>& positions, const std::vector<double>& masses, const GravitySettings& settings, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations);
+	void ComputeDirect(const std::vector<Vec3>& positions, const std::vector<double>& masses, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations);
+	void ComputeBarnesHut(const std::vector<Vec3>& positions, const std::vector<double>& masses, float theta, float softening, const std::vector<uint32_t>* targets, std::vector<glm::vec3>& accelerations);
+
+	Octree m_Octree;
+	ForceKernel m_Kernel;
+	Fmm m_Fmm;
+};
@@ -1,21 +1,29 @@
 #include "Grid.h"
 
+#include <glm/gtc/type_ptr.hpp>
+
 Grid::Grid(float size, int divisions)
 {
     Init(size, divisions);
 
-    m_Vertices = m_OgVerts;
-
+    // The mesh never changes; displacement happens in the vertex shader
     m_VAO = VAO();
     m_VAO.Bind();
 
-    m_VBO = new VBO(m_Vertices.data(), m_Vertices.size() * sizeof(GLfloat), GL_DYNAMIC_DRAW);
+    m_VBO = new VBO(m_OgVerts.data(), GLsizeiptr(m_OgVerts.size() * sizeof(GLfloat)));
 
     m_VAO.LinkAttrib(*m_VBO, 0, 3, GL_FLOAT, 6 * sizeof(float), (void*)0);
     m_VAO.LinkAttrib(*m_VBO, 1, 3, GL_FLOAT, 6 * sizeof(float), (void*)(3 * sizeof(float)));
 
     m_VAO.Unbind();
     m_VBO->Unbind();
+
+    m_Bodies = new StreamBuffer(GLsizeiptr(64 * sizeof(glm::vec4)));
+
+    glGenBuffers(1, &m_Highest);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Highest);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
 void Grid::Init(float size, int divisions)
@@ -79,50 +87,55 @@ void Grid::Init(float size, int divisions)
 void Grid::Update(float size, int divisions)
 {
     m_OgVerts.clear();
-    m_Vertices.clear();
     Init(size, divisions);
-    m_Vertices = m_OgVerts;
     m_VBO->Bind();
-    glBufferData(GL_ARRAY_BUFFER, m_Vertices.size() * sizeof(GLfloat), m_Vertices.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, m_OgVerts.size() * sizeof(GLfloat), m_OgVerts.data(), GL_STATIC_DRAW);
+    m_VBO->Unbind();
 }
 
-void Grid::Update(const std::vector<Body*> bodies, glm::vec3 camPos)
+void Grid::Update(const ParticleSystem& particles, const Vec3& center, const Camera& camera, Shader& reduceShader, GLuint bodyBuffer)
 {
-    m_Vertices = m_OgVerts;
-    glm::vec3 cPos = camPos * glm::vec3(1, 0, 1); // Remove y-axis
-
-    for (int i = 0; i < m_Vertices.size(); i += 6) {
-        m_Vertices[i]       += cPos.x;
-        m_Vertices[i + 2]   += cPos.z;
-        glm::vec3 vertexPos(m_Vertices[i], m_Vertices[i + 1], m_Vertices[i + 2]);
-        float totalDisplacement = 0.0f;
-        for (Body* body : bodies)
-        {
-            glm::vec3 toObject = body->Position - vertexPos;
-            float distance = glm::length(toObject);
-            float distance_m = distance * 1000.0f;
-            float rs = (2 * 6.67430e-11 * body->Mass) / pow(299792, 2);
-            
-            float dz = 2 * sqrt(rs * (distance_m - rs));
-            totalDisplacement += dz;
-        }
-
-        m_Vertices[i + 1]   = totalDisplacement;
+    m_Offset = camera.GetRelative(Vec3(center.x, 0, center.z)); // Remove y-axis
+    m_BodyCount = GLint(particles.Size());
+    m_BodyBuffer = bodyBuffer;
+    m_BodyOffset = 0;
+
+    if (m_BodyCount > 0 && !bodyBuffer)
+    {
+        glm::vec4* bodies = static_cast<glm::vec4*>(m_Bodies->Map(GLsizeiptr(m_BodyCount * sizeof(glm::vec4))));
+        for (size_t b = 0; b < particles.Size(); b++)
+            bodies[b] = glm::vec4(glm::vec3(particles.Positions[b]), float(6.67430e-11 * particles.Masses[b]));
+        m_BodyBuffer = m_Bodies->ID;
+        m_BodyOffset = m_Bodies->GetOffset();
     }
-    float highest = 0;
-    for (int i = 1; i < m_Vertices.size(); i += 6)
-        if (m_Vertices[i] > highest)
-            highest = m_Vertices[i];
-    for (int i = 1; i < m_Vertices.size(); i += 6)
-        m_Vertices[i] -= highest;
-
-    m_VBO->Update(m_Vertices.data(), GLsizeiptr(m_Vertices.size() * sizeof(GLfloat)));
+    BindBuffers();
+
+    GLuint zero = 0;
+    glClearNamedBufferData(m_Highest, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    GLint vertexCount = GLint(m_OgVerts.size() / 6);
+    reduceShader.Activate();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_VBO->ID);
+    reduceShader.SetVec3("uOffset", m_Offset);
+    reduceShader.SetInt("uBodyCount", m_BodyCount);
+    reduceShader.SetInt("uVertexCount", vertexCount);
+    glDispatchCompute((vertexCount + 255) / 256, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void Grid::Render(Shader& shader, Camera& camera)
+void Grid::BindBuffers()
+{
+    if (m_BodyCount > 0)
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_BodyBuffer, m_BodyOffset, GLsizeiptr(m_BodyCount * sizeof(glm::vec4)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_Highest);
+}
+
+void Grid::Render(Shader& shader)
 {
     shader.Activate();
-    camera.Update(shader);
+    shader.SetVec3("uOffset", m_Offset);
+    shader.SetInt("uBodyCount", m_BodyCount);
+    BindBuffers();
     m_VAO.Bind();
 
     glLineWidth(1.0f);
@@ -130,9 +143,19 @@ void Grid::Render(Shader& shader, Camera& camera)
     glDisable(GL_BLEND_COLOR);
     glDisable(GL_LINE_SMOOTH);
 
-    glDrawArrays(GL_LINES, 0, m_Vertices.size() / 6);
+    glDrawArrays(GL_LINES, 0, GLsizei(m_OgVerts.size() / 6));
 
     glEnable(GL_BLEND);
     glEnable(GL_BLEND_COLOR);
     glEnable(GL_LINE_SMOOTH);
 }
+
+void Grid::Destroy()
+{
+    m_VAO.Delete();
+    m_VBO->Delete();
+    m_Bodies->Delete();
+    glDeleteBuffers(1, &m_Highest);
+    delete m_VBO;
+    delete m_Bodies;
+}
@@ -3,9 +3,11 @@
 #include <glad/glad.h>
 
 #include "../renderer/gl/VAO.h"
+#include "../renderer/gl/VBO.h"
+#include "../renderer/gl/StreamBuffer.h"
 #include "../renderer/Shader.h"
 #include "../renderer/Camera.h"
-#include "Body.h"
+#include "ParticleSystem.h"
 
 class Grid
 {
@@ -13,15 +15,27 @@ public:
 	Grid(float size, int divisions);
 
 	void Update(float size, int divisions);
-	void Update(const std::vector<Body*> bodies, glm::vec3 camPos);
-	void Render(Shader& shader, Camera& camera);
+	// Uploads body positions and finds the highest displaced point on the GPU.
+	// center: world position of the grid, only x and z are used; the mesh is placed
+	// relative to the camera like everything else.
+	// bodyBuffer: optional storage buffer of vec4 (position, G * mass) to read instead
+	void Update(const ParticleSystem& particles, const Vec3& center, const Camera& camera, Shader& reduceShader, GLuint bodyBuffer=0);
+	// Displaces the static mesh in the vertex shader (grid-vert.glsl)
+	void Render(Shader& shader);
+	void Destroy();
 
 private:
 	void Init(float size, int divisions);
+	void BindBuffers();
 
 	VAO m_VAO;
 	VBO* m_VBO;
+	StreamBuffer* m_Bodies;
+	GLuint m_Highest;
 
-	std::vector<GLfloat> m_Vertices;
 	std::vector<GLfloat> m_OgVerts;
+	glm::vec3 m_Offset = glm::vec3(0.0f); // grid center relative to the camera
+	GLuint m_BodyBuffer = 0;
+	GLsizeiptr m_BodyOffset = 0;
+	GLint m_BodyCount = 0;
 };
\ No newline at end of file
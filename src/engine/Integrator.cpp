@@ -0,0 +1,160 @@
+#include "Integrator.h"
+
+#include <cmath>
+
+#include "../utils/ThreadPool.h"
+
+static const size_t GRAIN = 4096;
+
+// y += x * a, split across the thread pool; x is either state or float accelerations
+template<typename T>
+static void Accumulate(std::vector<Vec3>& y, const std::vector<T>& x, Real a)
+{
+	ThreadPool::Get().ParallelFor(0, y.size(), GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			y[i] += Vec3(x[i]) * a;
+	});
+}
+
+const char* GetIntegratorName(IntegratorScheme scheme)
+{
+	switch (scheme)
+	{
+	case IntegratorScheme::Euler: return "Semi-implicit Euler";
+	case IntegratorScheme::Leapfrog: return "Leapfrog (KDK)";
+	case IntegratorScheme::VelocityVerlet: return "Velocity Verlet";
+	case IntegratorScheme::Yoshida4: return "Yoshida 4th order";
+	case IntegratorScheme::RK4: return "Runge-Kutta 4";
+	}
+	return "";
+}
+
+int Integrator::GetForceEvaluations(IntegratorScheme scheme)
+{
+	switch (scheme)
+	{
+	case IntegratorScheme::Yoshida4: return 3;
+	case IntegratorScheme::RK4: return 4;
+	default: return 1;
+	}
+}
+
+void Integrator::Step(IntegratorScheme scheme, std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	switch (scheme)
+	{
+	case IntegratorScheme::Euler:
+		StepEuler(positions, velocities, dt, accelerate);
+		break;
+	case IntegratorScheme::Leapfrog:
+		StepLeapfrog(positions, velocities, dt, accelerate);
+		break;
+	case IntegratorScheme::VelocityVerlet:
+		StepVelocityVerlet(positions, velocities, dt, accelerate);
+		break;
+	case IntegratorScheme::Yoshida4:
+		StepYoshida4(positions, velocities, dt, accelerate);
+		break;
+	case IntegratorScheme::RK4:
+		StepRK4(positions, velocities, dt, accelerate);
+		break;
+	}
+}
+
+void Integrator::EnsureAcceleration(const std::vector<Vec3>& positions, const AccelerationFn& accelerate)
+{
+	if (!m_HasAcceleration || m_Acceleration.size() != positions.size())
+		accelerate(positions, m_Acceleration);
+	m_HasAcceleration = true;
+}
+
+void Integrator::StepEuler(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	accelerate(positions, m_Acceleration);
+	Accumulate(velocities, m_Acceleration, dt);
+	Accumulate(positions, velocities, dt);
+	m_HasAcceleration = false;
+}
+
+void Integrator::StepLeapfrog(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	EnsureAcceleration(positions, accelerate);
+	Accumulate(velocities, m_Acceleration, 0.5f * dt);	// kick
+	Accumulate(positions, velocities, dt);				// drift
+	accelerate(positions, m_Acceleration);
+	Accumulate(velocities, m_Acceleration, 0.5f * dt);	// kick
+}
+
+void Integrator::StepVelocityVerlet(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	EnsureAcceleration(positions, accelerate);
+	const Real step = dt;
+	ThreadPool::Get().ParallelFor(0, positions.size(), GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Vec3 acceleration(m_Acceleration[i]);
+			positions[i] += velocities[i] * step + acceleration * (Real(0.5) * step * step);
+			velocities[i] += acceleration * (Real(0.5) * step);
+		}
+	});
+	accelerate(positions, m_Acceleration);
+	Accumulate(velocities, m_Acceleration, 0.5f * dt);
+}
+
+void Integrator::StepYoshida4(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	// Forest-Ruth / Yoshida coefficients
+	const double cbrt2 = std::cbrt(2.0);
+	const double w1 = 1.0 / (2.0 - cbrt2);
+	const double w0 = -cbrt2 / (2.0 - cbrt2);
+	const Real c[4] = { Real(w1 / 2), Real((w0 + w1) / 2), Real((w0 + w1) / 2), Real(w1 / 2) };
+	const Real d[3] = { Real(w1), Real(w0), Real(w1) };
+
+	for (int stage = 0; stage < 3; stage++)
+	{
+		Accumulate(positions, velocities, c[stage] * dt);
+		accelerate(positions, m_Acceleration);
+		Accumulate(velocities, m_Acceleration, d[stage] * dt);
+	}
+	Accumulate(positions, velocities, c[3] * dt);
+	m_HasAcceleration = false;
+}
+
+void Integrator::StepRK4(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate)
+{
+	const size_t count = positions.size();
+	m_SumPositions.assign(count, Vec3(0));
+	m_SumVelocities.assign(count, Vec3(0));
+	m_StagePositions = positions;
+	m_StageVelocities = velocities;
+
+	// Stage k is evaluated at (x + h_k * dx_{k-1}, v + h_k * dv_{k-1}) and weighted by w_k
+	const Real step = dt;
+	const Real h[4] = { 0, step / 2, step / 2, step };
+	const Real w[4] = { step / 6, step / 3, step / 3, step / 6 };
+	for (int stage = 0; stage < 4; stage++)
+	{
+		accelerate(m_StagePositions, m_Acceleration);
+		ThreadPool::Get().ParallelFor(0, count, GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				// Derivative of this stage: dx = stage velocity, dv = acceleration
+				Vec3 dx = m_StageVelocities[i];
+				Vec3 dv(m_Acceleration[i]);
+				m_SumPositions[i] += dx * w[stage];
+				m_SumVelocities[i] += dv * w[stage];
+				if (stage < 3)
+				{
+					m_StagePositions[i] = positions[i] + dx * h[stage + 1];
+					m_StageVelocities[i] = velocities[i] + dv * h[stage + 1];
+				}
+			}
+		});
+	}
+	Accumulate(positions, m_SumPositions, 1.0f);
+	Accumulate(velocities, m_SumVelocities, 1.0f);
+	m_HasAcceleration = false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+enum class IntegratorScheme
+{
+	Euler,			// semi-implicit (symplectic) Euler, 1st order, 1 force evaluation
+	Leapfrog,		// kick-drift-kick, 2nd order, 1 force evaluation
+	VelocityVerlet,	// 2nd order, 1 force evaluation
+	Yoshida4,		// 4th order symplectic, 3 force evaluations
+	RK4				// classic Runge-Kutta, 4th order (not symplectic), 4 force evaluations
+};
+
+const char* GetIntegratorName(IntegratorScheme scheme);
+
+// Fills accelerations for the given positions
+typedef std::function<void(const std::vector<Vec3>& positions, std::vector<glm::vec3>& accelerations)> AccelerationFn;
+
+// Advances positions and velocities by one step of the chosen scheme.
+// Leapfrog and velocity Verlet reuse the acceleration from the end of the previous
+// step, so call Invalidate() whenever the state is changed from outside.
+class Integrator
+{
+public:
+	void Step(IntegratorScheme scheme, std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+	void Invalidate() { m_HasAcceleration = false; }
+
+	static int GetForceEvaluations(IntegratorScheme scheme);
+private:
+	void StepEuler(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+	void StepLeapfrog(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+	void StepVelocityVerlet(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+	void StepYoshida4(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+	void StepRK4(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, float dt, const AccelerationFn& accelerate);
+
+	void EnsureAcceleration(const std::vector<Vec3>& positions, const AccelerationFn& accelerate);
+
+	std::vector<glm::vec3> m_Acceleration;
+	bool m_HasAcceleration = false;
+
+	// RK4 stage storage
+	std::vector<Vec3> m_StagePositions, m_StageVelocities;
+	std::vector<Vec3> m_SumPositions, m_SumVelocities;
+};
@@ -0,0 +1,174 @@
+#include "Octree.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+
+int Octree::CreateNode(const Vec3& center, Real halfSize)
+{
+	Node node;
+	node.Center = center;
+	node.HalfSize = halfSize;
+	node.CenterOfMass = glm::dvec3(0.0);
+	node.Mass = 0.0;
+	for (int& child : node.Children)
+		child = -1;
+	node.Body = -1;
+	node.Count = 0;
+	m_Nodes.push_back(node);
+	return static_cast<int>(m_Nodes.size() - 1);
+}
+
+int Octree::GetChild(int node, const Vec3& position)
+{
+	const Vec3 center = m_Nodes[node].Center;
+	int octant = (position.x >= center.x ? 1 : 0) | (position.y >= center.y ? 2 : 0) | (position.z >= center.z ? 4 : 0);
+	if (m_Nodes[node].Children[octant] == -1)
+	{
+		Real quarter = m_Nodes[node].HalfSize / 2;
+		Vec3 offset((octant & 1) ? quarter : -quarter, (octant & 2) ? quarter : -quarter, (octant & 4) ? quarter : -quarter);
+		int child = CreateNode(center + offset, quarter); // may reallocate m_Nodes
+		m_Nodes[node].Children[octant] = child;
+	}
+	return m_Nodes[node].Children[octant];
+}
+
+void Octree::Build(const std::vector<Vec3>& positions, const std::vector<double>& masses)
+{
+	m_Nodes.clear();
+	m_Positions = &positions;
+	m_Masses = &masses;
+	m_Next.assign(positions.size(), -1);
+
+	Vec3 minBound(0), maxBound(0);
+	bool first = true;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		if (masses[i] == 0)
+			continue;
+		minBound = first ? positions[i] : glm::min(minBound, positions[i]);
+		maxBound = first ? positions[i] : glm::max(maxBound, positions[i]);
+		first = false;
+	}
+
+	Vec3 extent = maxBound - minBound;
+	Real halfSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, Real(1))) * Real(0.5 * 1.0001);
+	CreateNode((minBound + maxBound) / Real(2), halfSize);
+
+	for (size_t i = 0; i < positions.size(); i++)
+		if (masses[i] != 0)
+			Insert(static_cast<int>(i), positions[i], masses[i]);
+
+	for (Node& node : m_Nodes)
+		if (node.Mass != 0)
+			node.CenterOfMass /= node.Mass;
+}
+
+void Octree::Insert(int body, const Vec3& position, double mass)
+{
+	int node = 0;
+	for (int depth = 0; ; depth++)
+	{
+		m_Nodes[node].Mass += mass;
+		m_Nodes[node].CenterOfMass += glm::dvec3(position) * mass;
+
+		if (m_Nodes[node].IsLeaf())
+		{
+			if (m_Nodes[node].Count == 0)
+			{
+				m_Nodes[node].Body = body;
+				m_Nodes[node].Count = 1;
+				return;
+			}
+			// Coincident or extremely close bodies get merged into one aggregate leaf
+			if (depth >= MaxDepth)
+			{
+				m_Next[body] = m_Nodes[node].Body;
+				m_Nodes[node].Body = body;
+				m_Nodes[node].Count++;
+				return;
+			}
+
+			// Push the resident body one level down before descending
+			int resident = m_Nodes[node].Body;
+			const Vec3& residentPos = (*m_Positions)[resident];
+			double residentMass = (*m_Masses)[resident];
+			int child = GetChild(node, residentPos);
+			m_Nodes[child].Mass = residentMass;
+			m_Nodes[child].CenterOfMass = glm::dvec3(residentPos) * residentMass;
+			m_Nodes[child].Body = resident;
+			m_Nodes[child].Count = 1;
+			m_Nodes[node].Body = -1;
+		}
+
+		m_Nodes[node].Count++;
+		node = GetChild(node, position);
+	}
+}
+
+glm::vec3 Octree::GetAcceleration(const Vec3& position, int self, float theta, float softening) const
+{
+	if (m_Nodes.empty())
+		return glm::vec3(0.0f);
+
+	glm::dvec3 acceleration(0.0);
+	const glm::dvec3 pos(position);
+	const double theta2 = double(theta) * theta;
+	const double softening2 = double(softening) * softening;
+	auto addPointMass = [&](const glm::dvec3& centerOfMass, double mass)
+	{
+		glm::dvec3 d = centerOfMass - pos;
+		double soft2 = glm::dot(d, d) + softening2;
+		if (soft2 > 0)
+			acceleration += d * (G * mass / (soft2 * sqrt(soft2)));
+	};
+
+	int stack[8 * MaxDepth + 8];
+	int top = 0;
+
+	// Cells containing the position are always opened, however far their centre of mass
+	// lies, so the body's own mass never ends up in a point-mass approximation. Walk down
+	// the same octants Insert took and queue the siblings for the regular traversal.
+	int node = 0;
+	while (!m_Nodes[node].IsLeaf())
+	{
+		const Node& cell = m_Nodes[node];
+		int octant = (position.x >= cell.Center.x ? 1 : 0) | (position.y >= cell.Center.y ? 2 : 0) | (position.z >= cell.Center.z ? 4 : 0);
+		for (int child : cell.Children)
+			if (child != -1 && child != cell.Children[octant])
+				stack[top++] = child;
+		node = cell.Children[octant];
+		if (node == -1)
+			break;
+	}
+	if (node != -1)
+	{
+		// The body's own leaf, aggregated ones included, is summed body by body without it
+		for (int body = m_Nodes[node].Body; body != -1; body = m_Next[body])
+			if (body != self)
+				addPointMass(glm::dvec3((*m_Positions)[body]), (*m_Masses)[body]);
+	}
+
+	while (top > 0)
+	{
+		const Node& cell = m_Nodes[stack[--top]];
+		if (cell.Mass == 0)
+			continue;
+
+		glm::dvec3 d = cell.CenterOfMass - pos;
+		double size = 2.0 * cell.HalfSize;
+
+		// Opening criterion: treat the cell as a point mass when size/distance < theta
+		if (cell.IsLeaf() || size * size < theta2 * glm::dot(d, d))
+		{
+			addPointMass(cell.CenterOfMass, cell.Mass);
+			continue;
+		}
+
+		for (int child : cell.Children)
+			if (child != -1)
+				stack[top++] = child;
+	}
+	return glm::vec3(acceleration);
+}
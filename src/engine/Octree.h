@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Barnes-Hut octree over a set of point masses
+class Octree
+{
+public:
+	void Build(const std::vector<Vec3>& positions, const std::vector<double>& masses);
+	glm::vec3 GetAcceleration(const Vec3& position, int self, float theta, float softening) const;
+
+	static constexpr int MaxDepth = 32;
+private:
+	struct Node
+	{
+		Vec3 Center;
+		Real HalfSize;
+		glm::dvec3 CenterOfMass;
+		double Mass;
+		int Children[8];
+		int Body; // first body of a leaf, -1 if empty or inner; aggregated leaves chain the rest through m_Next
+		int Count;
+
+		bool IsLeaf() const
+		{
+			for (int child : Children)
+				if (child != -1)
+					return false;
+			return true;
+		}
+	};
+
+	int CreateNode(const Vec3& center, Real halfSize);
+	int GetChild(int node, const Vec3& position);
+	void Insert(int body, const Vec3& position, double mass);
+
+	std::vector<Node> m_Nodes;
+	std::vector<int> m_Next; // next body in the same aggregated leaf, -1 at the end
+	const std::vector<Vec3>* m_Positions = nullptr;
+	const std::vector<double>* m_Masses = nullptr;
+};
@@ -0,0 +1,77 @@
+#include "ParticleSystem.h"
+
+#include <cmath>
+
+size_t ParticleSystem::Add(const Vec3& pos, const Vec3& vel, double mass, float density, glm::vec3 color, bool glows)
+{
+	Positions.push_back(pos);
+	Velocities.push_back(vel);
+	Masses.push_back(mass);
+	Radii.push_back(0);
+	Densities.push_back(density);
+	Colors.push_back(color);
+	Glows.push_back(glows);
+
+	size_t index = Positions.size() - 1;
+	RefreshRadius(index);
+	return index;
+}
+
+void ParticleSystem::Remove(size_t index)
+{
+	Positions.erase(Positions.begin() + index);
+	Velocities.erase(Velocities.begin() + index);
+	Masses.erase(Masses.begin() + index);
+	Radii.erase(Radii.begin() + index);
+	Densities.erase(Densities.begin() + index);
+	Colors.erase(Colors.begin() + index);
+	Glows.erase(Glows.begin() + index);
+}
+
+template<typename T>
+static void Compact(std::vector<T>& values, const std::vector<uint8_t>& flags)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < values.size(); i++)
+		if (!flags[i])
+			values[kept++] = values[i];
+	values.resize(kept);
+}
+
+void ParticleSystem::RemoveFlagged(const std::vector<uint8_t>& flags)
+{
+	Compact(Positions, flags);
+	Compact(Velocities, flags);
+	Compact(Masses, flags);
+	Compact(Radii, flags);
+	Compact(Densities, flags);
+	Compact(Colors, flags);
+	Compact(Glows, flags);
+}
+
+void ParticleSystem::Clear()
+{
+	Positions.clear();
+	Velocities.clear();
+	Masses.clear();
+	Radii.clear();
+	Densities.clear();
+	Colors.clear();
+	Glows.clear();
+}
+
+void ParticleSystem::Reserve(size_t count)
+{
+	Positions.reserve(count);
+	Velocities.reserve(count);
+	Masses.reserve(count);
+	Radii.reserve(count);
+	Densities.reserve(count);
+	Colors.reserve(count);
+	Glows.reserve(count);
+}
+
+void ParticleSystem::RefreshRadius(size_t index)
+{
+	Radii[index] = static_cast<float>(pow(((3 * Masses[index] / Densities[index]) / (4 * 3.14159265359)), (1.0f / 3.0f)) / 30000);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Contiguous structure-of-arrays storage for every simulated body
+class ParticleSystem
+{
+public:
+	size_t Add(const Vec3& pos, const Vec3& vel, double mass, float density, glm::vec3 color=glm::vec3(1,1,1), bool glows=false);
+	void Remove(size_t index);
+	// Drops every body whose flag is set in one pass, keeping the order of the rest
+	void RemoveFlagged(const std::vector<uint8_t>& flags);
+	void Clear();
+	void Reserve(size_t count);
+	size_t Size() const { return Positions.size(); }
+	bool Empty() const { return Positions.empty(); }
+
+	void RefreshRadius(size_t index);
+
+	std::vector<Vec3> Positions;
+	std::vector<Vec3> Velocities;
+	std::vector<double> Masses;
+	std::vector<float> Radii;
+	std::vector<float> Densities;
+	std::vector<glm::vec3> Colors;
+	std::vector<uint8_t> Glows;
+};
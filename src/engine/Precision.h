@@ -0,0 +1,17 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Storage precision of the simulated state, chosen at compile time.
+// Positions and velocities are doubles unless UNIVERSE_DOUBLE_PRECISION is turned off:
+// at the 1e4 unit scale of the Solar System a float only resolves about 1e-3, coarser
+// than a small step moves a body. Accelerations stay float. The SIMD kernel only
+// recentres on the bounds centre, so its float error still grows with the span
+// (about 1e-3 absolute across 1e4 units). The FMM near field (per-leaf origins)
+// and the renderer (camera-relative) are the only float paths with local origins.
+#ifdef UNIVERSE_DOUBLE_PRECISION
+typedef double Real;
+typedef glm::dvec3 Vec3;
+#else
+typedef float Real;
+typedef glm::vec3 Vec3;
+#endif
@@ -0,0 +1,487 @@
+#include "Recording.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "../utils/MappedFile.h"
+
+static const char HeaderMagic[8] = { 'U', 'N', 'I', 'V', 'R', 'E', 'C', '\0' };
+static const char ChunkMagic[4] = { 'C', 'H', 'N', 'K' };
+static const char FooterMagic[8] = { 'U', 'N', 'I', 'V', 'I', 'D', 'X', '\0' };
+
+struct RecordingHeader
+{
+	char Magic[8];
+	uint32_t Version;
+	uint32_t Every;
+};
+static_assert(sizeof(RecordingHeader) == 16, "recording header layout changed");
+
+struct RecordingChunk
+{
+	char Magic[4];
+	uint32_t FrameCount;
+	uint64_t Bodies;
+	uint64_t Size; // bytes following this header
+};
+static_assert(sizeof(RecordingChunk) == 24, "recording chunk layout changed");
+
+struct RecordingFrame
+{
+	uint64_t Step;
+	double Time;
+};
+
+struct RecordingIndexEntry
+{
+	uint64_t Offset;
+	uint64_t FirstFrame;
+};
+
+struct RecordingFooter
+{
+	uint64_t IndexOffset;
+	uint64_t ChunkCount;
+	char Magic[8];
+};
+static_assert(sizeof(RecordingFooter) == 24, "recording footer layout changed");
+
+static size_t GetStaticSize(uint64_t bodies)
+{
+	return size_t(bodies) * (sizeof(double) + 2 * sizeof(float) + sizeof(glm::vec3) + sizeof(uint8_t));
+}
+
+static size_t GetKeyframeSize(uint64_t bodies)
+{
+	return sizeof(RecordingFrame) + size_t(bodies) * 2 * sizeof(glm::vec3);
+}
+
+// Frame header, a position and a velocity scale, then int16 deltas
+static size_t GetDeltaFrameSize(uint64_t bodies)
+{
+	return sizeof(RecordingFrame) + 2 * sizeof(float) + size_t(bodies) * 2 * 3 * sizeof(int16_t);
+}
+
+template<typename T>
+static void Append(std::vector<uint8_t>& out, const T* data, size_t count)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+// Quantizes current - previous to int16 with one scale for the whole array and
+// advances previous to the decoded value, so errors never accumulate
+static void EncodeDeltas(std::vector<uint8_t>& out, const std::vector<glm::vec3>& current, std::vector<glm::vec3>& previous)
+{
+	float largest = 0.0f;
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		glm::vec3 delta = current[i] - previous[i];
+		largest = std::max(largest, std::max(std::abs(delta.x), std::max(std::abs(delta.y), std::abs(delta.z))));
+	}
+	float scale = largest / 32767.0f;
+	Append(out, &scale, 1);
+
+	size_t start = out.size();
+	out.resize(start + current.size() * 3 * sizeof(int16_t));
+	int16_t* deltas = reinterpret_cast<int16_t*>(out.data() + start);
+	for (size_t i = 0; i < current.size(); i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int16_t q = scale > 0.0f ? int16_t(std::lround((current[i][c] - previous[i][c]) / scale)) : int16_t(0);
+			memcpy(deltas + i * 3 + c, &q, sizeof(q));
+			previous[i][c] += float(q) * scale;
+		}
+	}
+}
+
+// Frames are float on disk whatever the simulation precision
+static void Narrow(const std::vector<Vec3>& values, std::vector<glm::vec3>& out)
+{
+	out.resize(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		out[i] = glm::vec3(values[i]);
+}
+
+static void Widen(const std::vector<glm::vec3>& values, std::vector<Vec3>& out)
+{
+	out.resize(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		out[i] = Vec3(values[i]);
+}
+
+static const uint8_t* DecodeDeltas(const uint8_t* data, std::vector<glm::vec3>& values)
+{
+	float scale;
+	memcpy(&scale, data, sizeof(scale));
+	data += sizeof(scale);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int16_t q;
+			memcpy(&q, data, sizeof(q));
+			data += sizeof(q);
+			values[i][c] += float(q) * scale;
+		}
+	}
+	return data;
+}
+
+Recorder::~Recorder()
+{
+	Stop();
+}
+
+bool Recorder::Start(const std::string& path, int every)
+{
+	Stop();
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File)
+	{
+		std::cerr << "Error opening file: " << path << std::endl;
+		return false;
+	}
+
+	m_Every = std::max(every, 1);
+	RecordingHeader header = {};
+	memcpy(header.Magic, HeaderMagic, sizeof(HeaderMagic));
+	header.Version = RecordingVersion;
+	header.Every = uint32_t(m_Every);
+	m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_Offset = sizeof(header);
+
+	m_NextStep = 0;
+	m_HasStatic = false;
+	m_Frames = 0;
+	m_WrittenFrames = 0;
+	m_ChunkFrames = 0;
+	m_Index.clear();
+	m_Stopping = false;
+	m_Thread = std::thread(&Recorder::WriterLoop, this);
+	return true;
+}
+
+void Recorder::Capture(const Simulation& simulation)
+{
+	if (!IsRecording() || simulation.GetStepCount() < m_NextStep)
+		return;
+	m_NextStep = simulation.GetStepCount() + uint64_t(m_Every);
+
+	const ParticleSystem& particles = simulation.Particles;
+	Frame frame;
+	frame.Step = simulation.GetStepCount();
+	frame.Time = simulation.GetTime();
+	Narrow(particles.Positions, frame.Positions);
+	Narrow(particles.Velocities, frame.Velocities);
+	// Masses, colors and the like only change through edits
+	if (!m_HasStatic || m_Revision != simulation.GetRevision() || m_Bodies != particles.Size())
+	{
+		frame.Static = std::make_shared<StaticData>(StaticData{ particles.Masses, particles.Radii, particles.Densities, particles.Colors, particles.Glows });
+		m_Revision = simulation.GetRevision();
+		m_Bodies = particles.Size();
+		m_HasStatic = true;
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Wake.wait(lock, [this] { return m_Queue.size() < MaxQueuedFrames; });
+	m_Queue.push_back(std::move(frame));
+	m_Frames++;
+	m_Wake.notify_all();
+}
+
+void Recorder::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Wake.notify_all();
+	m_Thread.join();
+
+	FlushChunk();
+	RecordingFooter footer = {};
+	footer.IndexOffset = m_Offset;
+	footer.ChunkCount = m_Index.size();
+	memcpy(footer.Magic, FooterMagic, sizeof(FooterMagic));
+	for (const ChunkInfo& chunk : m_Index)
+	{
+		RecordingIndexEntry entry = { chunk.Offset, chunk.FirstFrame };
+		m_File.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+	}
+	m_File.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+	if (!m_File)
+		std::cerr << "Error writing recording" << std::endl;
+	m_File.close();
+}
+
+void Recorder::WriterLoop()
+{
+	while (true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+			if (m_Queue.empty())
+				return; // stopping and drained
+			frame = std::move(m_Queue.front());
+			m_Queue.pop_front();
+		}
+		m_Wake.notify_all();
+		Encode(frame);
+	}
+}
+
+void Recorder::Encode(const Frame& frame)
+{
+	if (frame.Static || m_ChunkFrames == FramesPerChunk)
+		FlushChunk();
+	if (frame.Static)
+		m_Static = frame.Static;
+
+	RecordingFrame header = { frame.Step, frame.Time };
+	if (m_ChunkFrames == 0)
+	{
+		const StaticData& data = *m_Static;
+		m_Chunk.clear();
+		Append(m_Chunk, data.Masses.data(), data.Masses.size());
+		Append(m_Chunk, data.Radii.data(), data.Radii.size());
+		Append(m_Chunk, data.Densities.data(), data.Densities.size());
+		Append(m_Chunk, data.Colors.data(), data.Colors.size());
+		Append(m_Chunk, data.Glows.data(), data.Glows.size());
+
+		Append(m_Chunk, &header, 1);
+		Append(m_Chunk, frame.Positions.data(), frame.Positions.size());
+		Append(m_Chunk, frame.Velocities.data(), frame.Velocities.size());
+		m_PrevPositions = frame.Positions;
+		m_PrevVelocities = frame.Velocities;
+		m_ChunkFirstFrame = m_WrittenFrames;
+	}
+	else
+	{
+		Append(m_Chunk, &header, 1);
+		EncodeDeltas(m_Chunk, frame.Positions, m_PrevPositions);
+		EncodeDeltas(m_Chunk, frame.Velocities, m_PrevVelocities);
+	}
+	m_ChunkFrames++;
+	m_WrittenFrames++;
+}
+
+void Recorder::FlushChunk()
+{
+	if (m_ChunkFrames == 0)
+		return;
+
+	RecordingChunk header = {};
+	memcpy(header.Magic, ChunkMagic, sizeof(ChunkMagic));
+	header.FrameCount = m_ChunkFrames;
+	header.Bodies = m_Static->Masses.size();
+	header.Size = m_Chunk.size();
+	m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_File.write(reinterpret_cast<const char*>(m_Chunk.data()), std::streamsize(m_Chunk.size()));
+
+	m_Index.push_back({ m_Offset, m_ChunkFirstFrame });
+	m_Offset += sizeof(header) + m_Chunk.size();
+	m_ChunkFrames = 0;
+}
+
+Replay::Replay() = default;
+
+Replay::~Replay() = default;
+
+bool Replay::Open(const std::string& path)
+{
+	Close();
+	m_File = std::make_unique<MappedFile>(path.c_str());
+	RecordingHeader header;
+	if (!m_File->IsOpen() || m_File->GetSize() < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, m_File->GetData(), sizeof(header));
+	if (memcmp(header.Magic, HeaderMagic, sizeof(HeaderMagic)) != 0 || header.Version > RecordingVersion)
+	{
+		std::cerr << "Not a supported recording: " << path << std::endl;
+		Close();
+		return false;
+	}
+
+	if (!ReadIndex() && !ScanChunks())
+	{
+		std::cerr << "Recording has no readable frames: " << path << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Replay::Close()
+{
+	m_File.reset();
+	m_Chunks.clear();
+	m_FrameCount = 0;
+	m_DecodedChunk = SIZE_MAX;
+	m_StaticData = nullptr;
+	m_StaticBodies = 0;
+}
+
+bool Replay::AddChunk(uint64_t offset, uint64_t firstFrame)
+{
+	RecordingChunk header;
+	size_t size = m_File->GetSize();
+	if (offset > size || size - offset < sizeof(header))
+		return false;
+	memcpy(&header, m_File->GetData() + offset, sizeof(header));
+	if (memcmp(header.Magic, ChunkMagic, sizeof(ChunkMagic)) != 0 || header.FrameCount == 0 ||
+		header.Size > size - offset - sizeof(header))
+		return false;
+	uint64_t expected = GetStaticSize(header.Bodies) + GetKeyframeSize(header.Bodies) + (header.FrameCount - 1) * GetDeltaFrameSize(header.Bodies);
+	if (expected != header.Size)
+		return false;
+
+	m_Chunks.push_back({ offset, firstFrame, header.FrameCount, header.Bodies });
+	m_FrameCount = size_t(firstFrame + header.FrameCount);
+	return true;
+}
+
+bool Replay::ReadIndex()
+{
+	RecordingFooter footer;
+	size_t size = m_File->GetSize();
+	if (size < sizeof(RecordingHeader) + sizeof(footer))
+		return false;
+	memcpy(&footer, m_File->GetData() + size - sizeof(footer), sizeof(footer));
+	if (memcmp(footer.Magic, FooterMagic, sizeof(FooterMagic)) != 0 ||
+		footer.IndexOffset > size || footer.ChunkCount > (size - footer.IndexOffset) / sizeof(RecordingIndexEntry))
+		return false;
+
+	const uint8_t* entries = m_File->GetData() + footer.IndexOffset;
+	for (uint64_t c = 0; c < footer.ChunkCount; c++)
+	{
+		RecordingIndexEntry entry;
+		memcpy(&entry, entries + c * sizeof(entry), sizeof(entry));
+		if (entry.FirstFrame != m_FrameCount || !AddChunk(entry.Offset, entry.FirstFrame))
+		{
+			m_Chunks.clear();
+			m_FrameCount = 0;
+			return false;
+		}
+	}
+	return !m_Chunks.empty();
+}
+
+bool Replay::ScanChunks()
+{
+	m_Chunks.clear();
+	m_FrameCount = 0;
+	uint64_t offset = sizeof(RecordingHeader);
+	while (AddChunk(offset, m_FrameCount))
+		offset += sizeof(RecordingChunk) + GetStaticSize(m_Chunks.back().Bodies) + GetKeyframeSize(m_Chunks.back().Bodies) +
+			(m_Chunks.back().FrameCount - 1) * GetDeltaFrameSize(m_Chunks.back().Bodies);
+	return !m_Chunks.empty();
+}
+
+size_t Replay::FindChunk(size_t frame) const
+{
+	auto it = std::upper_bound(m_Chunks.begin(), m_Chunks.end(), frame,
+		[](size_t f, const Chunk& chunk) { return f < chunk.FirstFrame; });
+	return size_t(it - m_Chunks.begin()) - 1;
+}
+
+const uint8_t* Replay::GetFrameData(const Chunk& chunk, uint32_t index) const
+{
+	size_t offset = sizeof(RecordingChunk) + GetStaticSize(chunk.Bodies);
+	if (index > 0)
+		offset += GetKeyframeSize(chunk.Bodies) + (index - 1) * GetDeltaFrameSize(chunk.Bodies);
+	return m_File->GetData() + chunk.Offset + offset;
+}
+
+uint64_t Replay::GetFrameStep(size_t frame) const
+{
+	if (frame >= m_FrameCount)
+		return 0;
+	const Chunk& chunk = m_Chunks[FindChunk(frame)];
+	RecordingFrame header;
+	memcpy(&header, GetFrameData(chunk, uint32_t(frame - chunk.FirstFrame)), sizeof(header));
+	return header.Step;
+}
+
+double Replay::GetFrameTime(size_t frame) const
+{
+	if (frame >= m_FrameCount)
+		return 0;
+	const Chunk& chunk = m_Chunks[FindChunk(frame)];
+	RecordingFrame header;
+	memcpy(&header, GetFrameData(chunk, uint32_t(frame - chunk.FirstFrame)), sizeof(header));
+	return header.Time;
+}
+
+bool Replay::ReadFrame(size_t frame, ParticleSystem& particles)
+{
+	if (!IsOpen() || frame >= m_FrameCount)
+		return false;
+
+	size_t chunkIndex = FindChunk(frame);
+	const Chunk& chunk = m_Chunks[chunkIndex];
+	uint32_t index = uint32_t(frame - chunk.FirstFrame);
+	size_t bodies = size_t(chunk.Bodies);
+
+	// Deltas only decode forward from the keyframe or the last decoded frame
+	uint32_t decoded;
+	if (m_DecodedChunk == chunkIndex && m_DecodedIndex <= index)
+		decoded = m_DecodedIndex;
+	else
+	{
+		const uint8_t* data = GetFrameData(chunk, 0) + sizeof(RecordingFrame);
+		m_Positions.resize(bodies);
+		m_Velocities.resize(bodies);
+		memcpy(m_Positions.data(), data, bodies * sizeof(glm::vec3));
+		memcpy(m_Velocities.data(), data + bodies * sizeof(glm::vec3), bodies * sizeof(glm::vec3));
+		decoded = 0;
+	}
+	for (uint32_t i = decoded + 1; i <= index; i++)
+	{
+		const uint8_t* data = GetFrameData(chunk, i) + sizeof(RecordingFrame);
+		data = DecodeDeltas(data, m_Positions);
+		DecodeDeltas(data, m_Velocities);
+	}
+
+	bool newChunk = m_DecodedChunk != chunkIndex || particles.Size() != bodies;
+	m_DecodedChunk = chunkIndex;
+	m_DecodedIndex = index;
+
+	// Body properties are per chunk and only need copying when the chunk changes
+	if (newChunk)
+	{
+		const uint8_t* data = m_File->GetData() + chunk.Offset + sizeof(RecordingChunk);
+		// Chunks also split on length alone; only a different body set is a new revision
+		if (!m_StaticData || m_StaticBodies != bodies || memcmp(m_StaticData, data, GetStaticSize(bodies)) != 0)
+			m_Revision++;
+		m_StaticData = data;
+		m_StaticBodies = bodies;
+		particles.Masses.resize(bodies);
+		particles.Radii.resize(bodies);
+		particles.Colors.resize(bodies);
+		particles.Glows.resize(bodies);
+		particles.Densities.resize(bodies);
+		memcpy(particles.Masses.data(), data, bodies * sizeof(double));
+		data += bodies * sizeof(double);
+		memcpy(particles.Radii.data(), data, bodies * sizeof(float));
+		data += bodies * sizeof(float);
+		memcpy(particles.Densities.data(), data, bodies * sizeof(float));
+		data += bodies * sizeof(float);
+		memcpy(particles.Colors.data(), data, bodies * sizeof(glm::vec3));
+		data += bodies * sizeof(glm::vec3);
+		memcpy(particles.Glows.data(), data, bodies * sizeof(uint8_t));
+	}
+	Widen(m_Positions, particles.Positions);
+	Widen(m_Velocities, particles.Velocities);
+	return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Simulation.h"
+
+class MappedFile;
+
+// Recording file layout (little-endian):
+//   RecordingHeader
+//   chunks: RecordingChunk, body properties (masses, radii, densities, colors, glows),
+//           then FrameCount frames. The first frame of a chunk is a float keyframe; the
+//           others store int16 deltas from the previous decoded frame, scaled per frame.
+//   index:  one RecordingIndexEntry per chunk, then RecordingFooter
+// A file without a footer (e.g. after a crash) is replayed by scanning the chunks.
+const uint32_t RecordingVersion = 1;
+
+// Writes the body state every Every steps; encoding and disk writes run on a
+// background thread. Up to MaxQueuedFrames captured frames wait for it, plus
+// the chunk being encoded; Capture blocks once the queue is full.
+class Recorder
+{
+public:
+	~Recorder();
+
+	bool Start(const std::string& path, int every);
+	// Queues the current state once at least Every steps passed since the last frame
+	void Capture(const Simulation& simulation);
+	// Flushes the open chunk and writes the index
+	void Stop();
+
+	bool IsRecording() const { return m_Thread.joinable(); }
+	uint64_t GetFrameCount() const { return m_Frames; }
+
+	static const uint32_t FramesPerChunk = 64;
+	static const size_t MaxQueuedFrames = 256; // Capture blocks beyond this
+private:
+	struct StaticData
+	{
+		std::vector<double> Masses;
+		std::vector<float> Radii;
+		std::vector<float> Densities;
+		std::vector<glm::vec3> Colors;
+		std::vector<uint8_t> Glows;
+	};
+	struct Frame
+	{
+		uint64_t Step;
+		double Time;
+		std::vector<glm::vec3> Positions, Velocities;
+		std::shared_ptr<StaticData> Static; // set when the bodies changed, starts a new chunk
+	};
+
+	void WriterLoop();
+	void Encode(const Frame& frame);
+	void FlushChunk();
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::deque<Frame> m_Queue;
+	bool m_Stopping = false;
+
+	// Capture side
+	int m_Every = 1;
+	uint64_t m_NextStep = 0;
+	uint64_t m_Revision = 0;
+	size_t m_Bodies = 0;
+	bool m_HasStatic = false;
+	uint64_t m_Frames = 0;
+
+	// Writer side
+	std::ofstream m_File;
+	uint64_t m_Offset = 0;
+	std::shared_ptr<StaticData> m_Static;
+	std::vector<uint8_t> m_Chunk;
+	uint32_t m_ChunkFrames = 0;
+	uint64_t m_ChunkFirstFrame = 0;
+	uint64_t m_WrittenFrames = 0;
+	std::vector<glm::vec3> m_PrevPositions, m_PrevVelocities;
+	struct ChunkInfo { uint64_t Offset, FirstFrame; };
+	std::vector<ChunkInfo> m_Index;
+};
+
+// Random access playback of a recording through a memory mapping; no physics runs
+class Replay
+{
+public:
+	Replay();
+	~Replay();
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return m_File != nullptr; }
+
+	size_t GetFrameCount() const { return m_FrameCount; }
+	uint64_t GetFrameStep(size_t frame) const;
+	double GetFrameTime(size_t frame) const;
+	// Replaces the bodies with the recorded state of frame
+	bool ReadFrame(size_t frame, ParticleSystem& particles);
+	// Changes whenever ReadFrame replaces the recorded body set, not on every frame
+	uint64_t GetRevision() const { return m_Revision; }
+private:
+	struct Chunk
+	{
+		uint64_t Offset;	 // of the chunk header
+		uint64_t FirstFrame;
+		uint32_t FrameCount;
+		uint64_t Bodies;
+	};
+
+	bool ReadIndex();
+	bool ScanChunks();
+	bool AddChunk(uint64_t offset, uint64_t firstFrame);
+	size_t FindChunk(size_t frame) const;
+	const uint8_t* GetFrameData(const Chunk& chunk, uint32_t index) const;
+
+	std::unique_ptr<MappedFile> m_File;
+	std::vector<Chunk> m_Chunks;
+	size_t m_FrameCount = 0;
+
+	// Last decoded frame, so playing forward decodes one delta per frame
+	size_t m_DecodedChunk = SIZE_MAX;
+	uint32_t m_DecodedIndex = 0;
+	std::vector<glm::vec3> m_Positions, m_Velocities;
+
+	// Body properties of the decoded chunk, to tell a new body set from a chunk split
+	const uint8_t* m_StaticData = nullptr;
+	size_t m_StaticBodies = 0;
+	uint64_t m_Revision = 0;
+};
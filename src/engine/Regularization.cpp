@@ -0,0 +1,227 @@
+#include "Regularization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include "../utils/ThreadPool.h"
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+static const double Pi = 3.14159265358979323846;
+static const uint32_t Unpaired = UINT32_MAX;
+static const size_t GRAIN = 4096;
+
+static uint64_t HashCell(const glm::i64vec3& cell)
+{
+	return uint64_t(cell.x) * 73856093u ^ uint64_t(cell.y) * 19349663u ^ uint64_t(cell.z) * 83492791u;
+}
+
+// Stumpff functions c2(z) and c3(z)
+static void Stumpff(double z, double& c, double& s)
+{
+	if (z > 1e-6)
+	{
+		double root = sqrt(z);
+		c = (1 - cos(root)) / z;
+		s = (root - sin(root)) / (z * root);
+	}
+	else if (z < -1e-6)
+	{
+		double root = sqrt(-z);
+		c = (cosh(root) - 1) / -z;
+		s = (sinh(root) - root) / (-z * root);
+	}
+	else
+	{
+		c = 0.5 - z / 24;
+		s = 1.0 / 6 - z / 120;
+	}
+}
+
+bool PropagateKepler(glm::dvec3& position, glm::dvec3& velocity, double mu, double dt)
+{
+	double r0 = glm::length(position);
+	if (r0 == 0 || mu <= 0)
+		return false;
+	double sqrtMu = sqrt(mu);
+	double sigma = glm::dot(position, velocity) / sqrtMu;
+	double alpha = 2 / r0 - glm::dot(velocity, velocity) / mu; // inverse semi-major axis
+
+	// Whole revolutions of a bound orbit change nothing and only slow the solver down
+	if (alpha > 0)
+		dt = fmod(dt, 2 * Pi / (sqrtMu * alpha * sqrt(alpha)));
+
+	// Laguerre-Conway iteration on the universal Kepler equation F(chi) = 0, which
+	// unlike plain Newton converges from this guess even for very eccentric orbits
+	const double n = 5;
+	double chi = alpha > 0 ? sqrtMu * alpha * dt : sqrtMu * dt / r0;
+	double c = 0.5, s = 1.0 / 6, r = r0;
+	bool converged = false;
+	for (int iteration = 0; iteration < 50 && !converged; iteration++)
+	{
+		double chi2 = chi * chi;
+		double z = alpha * chi2;
+		Stumpff(z, c, s);
+		double f = sigma * chi2 * c + (1 - alpha * r0) * chi2 * chi * s + r0 * chi - sqrtMu * dt;
+		r = sigma * chi * (1 - z * s) + (1 - alpha * r0) * chi2 * c + r0; // F'
+		double f2 = sigma * (1 - z * c) + (1 - alpha * r0) * chi * (1 - z * s);
+		double root = sqrt(fabs((n - 1) * (n - 1) * r * r - n * (n - 1) * f * f2));
+		double delta = n * f / (r + (r >= 0 ? root : -root));
+		chi -= delta;
+		converged = fabs(delta) <= 1e-12 * std::max(1.0, fabs(chi));
+	}
+	if (!converged || !std::isfinite(chi))
+		return false;
+
+	// Lagrange coefficients at the solution
+	double chi2 = chi * chi;
+	Stumpff(alpha * chi2, c, s);
+	double f = 1 - chi2 * c / r0;
+	double g = dt - chi2 * chi * s / sqrtMu;
+	glm::dvec3 newPosition = f * position + g * velocity;
+	r = glm::length(newPosition);
+	if (r == 0)
+		return false;
+	double fDot = sqrtMu / (r * r0) * chi * (alpha * chi2 * s - 1);
+	double gDot = 1 - chi2 * c / r;
+	velocity = fDot * position + gDot * velocity;
+	position = newPosition;
+	return true;
+}
+
+void Regularization::FindPairs(const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities, const std::vector<double>& masses)
+{
+	size_t count = positions.size();
+	m_Partners.assign(count, Unpaired);
+	m_Pairs.clear();
+	if (Radius <= 0 || count < 2)
+		return;
+
+	// Bodies sorted by the hash of their Radius sized cell; any partner is in one of
+	// the 27 cells around a body
+	const double inverseCell = 1.0 / Radius;
+	m_Cells.resize(count);
+	ThreadPool& pool = ThreadPool::Get();
+	pool.ParallelFor(0, count, GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			m_Cells[i] = { HashCell(glm::i64vec3(glm::floor(glm::dvec3(positions[i]) * inverseCell))), static_cast<uint32_t>(i) };
+	});
+	std::sort(m_Cells.begin(), m_Cells.end());
+
+	// Every body proposes its nearest bound neighbour; only mutual choices become pairs
+	const double radius2 = double(Radius) * Radius;
+	std::vector<uint32_t> nearest(count, Unpaired);
+	pool.ParallelFor(0, count, 256, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (masses[i] == 0)
+				continue;
+			glm::i64vec3 cell(glm::floor(glm::dvec3(positions[i]) * inverseCell));
+			double best = radius2;
+			for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				uint64_t hash = HashCell(cell + glm::i64vec3(dx, dy, dz));
+				auto first = std::lower_bound(m_Cells.begin(), m_Cells.end(), std::make_pair(hash, uint32_t(0)));
+				for (auto it = first; it != m_Cells.end() && it->first == hash; ++it)
+				{
+					uint32_t j = it->second;
+					if (j == i || masses[j] == 0)
+						continue;
+					glm::dvec3 d = glm::dvec3(positions[j]) - glm::dvec3(positions[i]);
+					double dist2 = glm::dot(d, d);
+					if (dist2 == 0 || dist2 >= best)
+						continue;
+					glm::dvec3 v = glm::dvec3(velocities[j]) - glm::dvec3(velocities[i]);
+					double energy = 0.5 * glm::dot(v, v) - G * (masses[i] + masses[j]) / sqrt(dist2);
+					if (energy < 0)
+					{
+						best = dist2;
+						nearest[i] = j;
+					}
+				}
+			}
+		}
+	});
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t j = nearest[i];
+		if (j != Unpaired && j > i && nearest[j] == i)
+		{
+			m_Partners[i] = j;
+			m_Partners[j] = static_cast<uint32_t>(i);
+			m_Pairs.emplace_back(static_cast<uint32_t>(i), j);
+		}
+	}
+}
+
+void Regularization::Kick(const std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float softening, float dt)
+{
+	const double softening2 = double(softening) * softening;
+	ThreadPool::Get().ParallelFor(0, positions.size(), GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Vec3 acceleration(m_Acceleration[i]);
+			uint32_t j = m_Partners[i];
+			if (j != Unpaired)
+			{
+				// Same expression as the solvers, so the pair term cancels to round-off
+				glm::dvec3 d = glm::dvec3(positions[j]) - glm::dvec3(positions[i]);
+				double dist2 = glm::dot(d, d) + softening2;
+				acceleration -= Vec3(d * (G * masses[j] / (dist2 * sqrt(dist2))));
+			}
+			velocities[i] += acceleration * Real(dt);
+		}
+	});
+}
+
+void Regularization::Drift(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float dt)
+{
+	ThreadPool& pool = ThreadPool::Get();
+	pool.ParallelFor(0, positions.size(), GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			if (m_Partners[i] == Unpaired)
+				positions[i] += velocities[i] * Real(dt);
+	});
+	pool.ParallelFor(0, m_Pairs.size(), 64, [&](size_t begin, size_t end)
+	{
+		for (size_t p = begin; p < end; p++)
+		{
+			uint32_t i = m_Pairs[p].first, j = m_Pairs[p].second;
+			double massI = masses[i], massJ = masses[j], mass = massI + massJ;
+			glm::dvec3 center = (glm::dvec3(positions[i]) * massI + glm::dvec3(positions[j]) * massJ) / mass;
+			glm::dvec3 centerVelocity = (glm::dvec3(velocities[i]) * massI + glm::dvec3(velocities[j]) * massJ) / mass;
+			glm::dvec3 separation = glm::dvec3(positions[j]) - glm::dvec3(positions[i]);
+			glm::dvec3 relative = glm::dvec3(velocities[j]) - glm::dvec3(velocities[i]);
+
+			center += centerVelocity * double(dt);
+			if (!PropagateKepler(separation, relative, G * mass, dt))
+				separation += relative * double(dt); // unpropagated, drift like everything else
+
+			positions[i] = Vec3(center - separation * (massJ / mass));
+			positions[j] = Vec3(center + separation * (massI / mass));
+			velocities[i] = Vec3(centerVelocity - relative * (massJ / mass));
+			velocities[j] = Vec3(centerVelocity + relative * (massI / mass));
+		}
+	});
+}
+
+void Regularization::Step(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float softening, float dt, const AccelerationFn& accelerate)
+{
+	if (!m_HasAcceleration || m_Acceleration.size() != positions.size())
+		accelerate(positions, m_Acceleration);
+	m_HasAcceleration = true;
+
+	FindPairs(positions, velocities, masses);
+	Kick(positions, velocities, masses, softening, 0.5f * dt);
+	Drift(positions, velocities, masses, dt);
+	accelerate(positions, m_Acceleration);
+	Kick(positions, velocities, masses, softening, 0.5f * dt);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Integrator.h"
+
+// Kick-drift-kick leapfrog that treats tight bound pairs as two-body problems.
+// The mutual pull of every bound pair closer than Radius is left out of the kicks;
+// in the drift the pair's centre of mass moves in a straight line while the relative
+// orbit is advanced exactly on its Kepler conic. A close binary or a grazing flyby is
+// then no longer what limits the step size, and the rest of the system still perturbs
+// the pair through the kicks. Pairs are chosen afresh at the start of every step.
+class Regularization
+{
+public:
+	void Step(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float softening, float dt, const AccelerationFn& accelerate);
+	void Invalidate() { m_HasAcceleration = false; }
+
+	// Pairs of the last step, (i < j)
+	const std::vector<std::pair<uint32_t, uint32_t>>& GetPairs() const { return m_Pairs; }
+
+	float Radius = 500.0f; // largest separation of a regularized pair
+private:
+	void FindPairs(const std::vector<Vec3>& positions, const std::vector<Vec3>& velocities, const std::vector<double>& masses);
+	// Kick by the accelerations minus the pull of each body's partner
+	void Kick(const std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float softening, float dt);
+	void Drift(std::vector<Vec3>& positions, std::vector<Vec3>& velocities, const std::vector<double>& masses, float dt);
+
+	std::vector<std::pair<uint32_t, uint32_t>> m_Pairs;
+	std::vector<uint32_t> m_Partners; // per body, UINT32_MAX when unpaired
+	std::vector<std::pair<uint64_t, uint32_t>> m_Cells; // (cell hash, body), sorted
+
+	std::vector<glm::vec3> m_Acceleration;
+	bool m_HasAcceleration = false;
+};
+
+// Advances a relative two-body orbit by dt with the universal-variable Kepler solver.
+// mu is G times the total mass. Returns false (and leaves the state alone) if it fails.
+bool PropagateKepler(glm::dvec3& position, glm::dvec3& velocity, double mu, double dt);
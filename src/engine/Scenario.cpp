@@ -0,0 +1,230 @@
+#include "Scenario.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+static const double G = 6.67430e-11; // Universal gravitation constant
+static const double Pi = 3.14159265358979323846;
+
+struct ScenarioEntry
+{
+	const char* Name;
+	void (*Load)(ParticleSystem& particles);
+};
+
+static void LoadSolarSystem(ParticleSystem& particles)
+{
+	// POSITION, VELOCITY, MASS, DENSITY, COLOR
+	//SUN
+	particles.Add(Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f), 1.989e25, 1414, glm::vec3(1.0f, 0.0f, 0.0f), true);
+	//mars
+	particles.Add(Vec3(-3000.0f, 650.0f, 0.0f), Vec3(0.0f, 0.0f, 500.0f), 5.97219e23, 5515, glm::vec3(1.0f, 0.25f, 0.56f));
+	//earth
+	particles.Add(Vec3(5000.0f, 650.0f, 0.0f), Vec3(0.0f, 0.0f, -500.0f), 5.97219e23, 5515, glm::vec3(0.0f, 1.0f, 1.0f));
+	//moon
+	particles.Add(Vec3(5250.0f, 650.0f, 0.0f), Vec3(0.0f, 0.0f, -50.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+
+	//Jupiter
+	particles.Add(Vec3(0.0f, 500.0f, 9000.0f), Vec3(-500.0f, 50.0f, 0.0f), 5.97219 * pow(10, 23.5), 5515, glm::vec3(1.0f, 0.5f, 0.15f));
+	particles.Add(Vec3(0.0f, 550.0f, 9500.0f), Vec3(0.0f, 0.0f, -50.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+	particles.Add(Vec3(0.0f, 450.0f, 8500.0f), Vec3(0.0f, 0.0f, -50.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+	particles.Add(Vec3(100.0f, 500.0f, 9000.0f), Vec3(50.0f, 0.0f, 0.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+
+	//Neptune
+	particles.Add(Vec3(0.0f, -500.0f, -10500.0f), Vec3(-350.0f, 50.0f, 0.0f), 5.97219 * pow(10, 23.5), 5515, glm::vec3(0.35f, 0.5f, 0.15f));
+	particles.Add(Vec3(350.0f, -450.0f, -10500.0f), Vec3(0.0f, 0.0f, -550.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+	particles.Add(Vec3(-350.0f, 450.0f, -10500.0f), Vec3(0.0f, 0.0f, -550.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+	particles.Add(Vec3(0.0f, -450.0f, -10500.0f), Vec3(-550.0f, 0.0f, 0.0f), 5.97219e21, 5515, glm::vec3(1.0f, 1.0f, 1.0f));
+}
+
+static void LoadStableOrbit(ParticleSystem& particles)
+{
+	particles.Add(Vec3(), Vec3(), 1e20, 1, glm::vec3(1,1,1), true);
+	particles.Add(Vec3(1000, 0, 0), Vec3(0, 0, -3000), 1e18, 1, glm::vec3(0,0,1));
+}
+
+static void LoadDynamicOrbit(ParticleSystem& particles)
+{
+	particles.Add(Vec3(), Vec3(0, 1000, 0), 1e20, 1, glm::vec3(1,1,1), true);
+	particles.Add(Vec3(1000, 0, 0), Vec3(0, 0, -3000), 1e18, 1, glm::vec3(0,0,1));
+}
+
+static void LoadSpinnyOrbit(ParticleSystem& particles)
+{
+	particles.Add(Vec3(), Vec3(0, 1000, 0), 1e20, 1411, glm::vec3(1,1,1), true);
+	particles.Add(Vec3(200, 200, -200), Vec3(0, 0, 7500), 1e20, 1411, glm::vec3(0,0,1));
+}
+
+static void LoadBlackholeOrbit(ParticleSystem& particles)
+{
+	particles.Add(Vec3(), Vec3(0, 10000, 0), 1e22, 3000, glm::vec3(1,1,1), true);
+	particles.Add(Vec3(0, 250, 2500), Vec3(0, -10000, 0), 1e22, 3000, glm::vec3(1,1,1), true);
+}
+
+static void LoadEmpty(ParticleSystem& particles)
+{
+}
+
+// std distributions differ between standard libraries, mt19937 itself does not.
+// The libm functions applied to these samples are not correctly rounded, so the
+// bodies only repeat exactly with the same toolchain.
+static double Uniform(std::mt19937& rng)
+{
+	return (rng() + 0.5) / 4294967296.0;
+}
+
+static glm::dvec3 RandomDirection(std::mt19937& rng)
+{
+	double z = 2 * Uniform(rng) - 1;
+	double phi = 2 * Pi * Uniform(rng);
+	double r = sqrt(1 - z * z);
+	return glm::dvec3(r * cos(phi), r * sin(phi), z);
+}
+
+static void RemoveDrift(ParticleSystem& particles, size_t first)
+{
+	// Keeps the generated bodies centred and at rest as a whole
+	glm::dvec3 position(0.0), velocity(0.0);
+	double mass = 0;
+	for (size_t i = first; i < particles.Size(); i++)
+	{
+		position += glm::dvec3(particles.Positions[i]) * particles.Masses[i];
+		velocity += glm::dvec3(particles.Velocities[i]) * particles.Masses[i];
+		mass += particles.Masses[i];
+	}
+	if (mass <= 0)
+		return;
+	for (size_t i = first; i < particles.Size(); i++)
+	{
+		particles.Positions[i] -= Vec3(position / mass);
+		particles.Velocities[i] -= Vec3(velocity / mass);
+	}
+}
+
+void GeneratePlummerSphere(ParticleSystem& particles, size_t count, uint32_t seed)
+{
+	const double totalMass = 1e24;
+	const double scale = 4000; // Plummer radius
+	std::mt19937 rng(seed);
+	particles.Clear();
+	particles.Reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Aarseth, Henon & Wielen (1974): radius from the inverse cumulative mass,
+		// speed by rejection sampling of q^2 (1 - q^2)^3.5
+		double r;
+		do
+			r = scale / sqrt(pow(Uniform(rng), -2.0 / 3.0) - 1);
+		while (r > 10 * scale);
+		double q, g;
+		do
+		{
+			q = Uniform(rng);
+			g = 0.1 * Uniform(rng);
+		} while (g > q * q * pow(1 - q * q, 3.5));
+		double escape = sqrt(2 * G * totalMass / sqrt(r * r + scale * scale));
+
+		float warmth = static_cast<float>(Uniform(rng));
+		particles.Add(Vec3(RandomDirection(rng) * r), Vec3(RandomDirection(rng) * (q * escape)),
+			totalMass / count, 1400, glm::vec3(1.0f, 0.6f + 0.4f * warmth, 0.3f + 0.5f * warmth));
+	}
+	RemoveDrift(particles, 0);
+}
+
+void GenerateDiskGalaxy(ParticleSystem& particles, size_t count, uint32_t seed)
+{
+	const double bulgeMass = 5e24;
+	const double diskMass = 1e24;
+	const double scale = 3000;	  // exponential scale length
+	const double thickness = 100; // vertical scale
+	std::mt19937 rng(seed);
+	particles.Clear();
+	if (count == 0)
+		return;
+	particles.Reserve(count);
+	particles.Add(Vec3(), Vec3(), bulgeMass, 3000, glm::vec3(1.0f, 0.9f, 0.7f), true);
+
+	size_t stars = count - 1;
+	for (size_t i = 0; i < stars; i++)
+	{
+		// The sum of two exponential variates follows the surface density R exp(-R / scale)
+		double radius = -scale * log(Uniform(rng) * Uniform(rng)) + 0.2 * scale;
+		double angle = 2 * Pi * Uniform(rng);
+		double height = thickness * sqrt(-2 * log(Uniform(rng))) * cos(2 * Pi * Uniform(rng));
+		double x = radius / scale;
+		double enclosed = bulgeMass + diskMass * (1 - (1 + x) * exp(-x));
+		double speed = sqrt(G * enclosed / radius);
+
+		glm::dvec3 position(radius * cos(angle), height, radius * sin(angle));
+		glm::dvec3 velocity(-speed * sin(angle), 0, speed * cos(angle));
+		float blue = static_cast<float>(std::min(1.0, x / 3));
+		particles.Add(Vec3(position), Vec3(velocity), diskMass / stars, 1400,
+			glm::vec3(1.0f - 0.4f * blue, 0.8f, 0.6f + 0.4f * blue));
+	}
+	RemoveDrift(particles, 0);
+}
+
+void GenerateSolarSystem(ParticleSystem& particles, size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	particles.Clear();
+	LoadSolarSystem(particles);
+	particles.Reserve(count);
+
+	// Asteroids on circular orbits around the sun, between Earth and Jupiter
+	const double sunMass = particles.Masses[0];
+	while (particles.Size() < count)
+	{
+		double radius = 6000 + 2500 * Uniform(rng);
+		double angle = 2 * Pi * Uniform(rng);
+		double height = 150 * (2 * Uniform(rng) - 1);
+		double speed = sqrt(G * sunMass / radius);
+		float shade = 0.4f + 0.3f * static_cast<float>(Uniform(rng));
+		particles.Add(Vec3(radius * cos(angle), 650 + height, radius * sin(angle)),
+			Vec3(-speed * sin(angle), 0, speed * cos(angle)), 1e16 * (1 + 9 * Uniform(rng)), 2000, glm::vec3(shade));
+	}
+}
+
+static void LoadPlummerSphere(ParticleSystem& particles)
+{
+	GeneratePlummerSphere(particles, 2000, 1);
+}
+
+static void LoadDiskGalaxy(ParticleSystem& particles)
+{
+	GenerateDiskGalaxy(particles, 2000, 1);
+}
+
+static const ScenarioEntry s_Scenarios[] = {
+	{ "Solar System", LoadSolarSystem },
+	{ "Stable Orbit", LoadStableOrbit },
+	{ "Dynamic Orbit", LoadDynamicOrbit },
+	{ "Spinny Orbit", LoadSpinnyOrbit },
+	{ "Blackhole orbit", LoadBlackholeOrbit },
+	{ "Plummer Sphere", LoadPlummerSphere },
+	{ "Disk Galaxy", LoadDiskGalaxy },
+	{ "Empty", LoadEmpty },
+};
+
+const std::vector<std::string>& GetScenarioNames()
+{
+	static std::vector<std::string> names;
+	if (names.empty())
+		for (const ScenarioEntry& entry : s_Scenarios)
+			names.push_back(entry.Name);
+	return names;
+}
+
+bool LoadScenario(const std::string& name, ParticleSystem& particles)
+{
+	for (const ScenarioEntry& entry : s_Scenarios)
+	{
+		if (name != entry.Name)
+			continue;
+		particles.Clear();
+		entry.Load(particles);
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ParticleSystem.h"
+
+// Built-in starting configurations, shared by the preset menu and headless runs
+const std::vector<std::string>& GetScenarioNames();
+bool LoadScenario(const std::string& name, ParticleSystem& particles);
+
+// Procedural workloads for the presets and benchmarks. The bodies depend only on
+// count and seed for a given toolchain; the math library may round differently
+// elsewhere.
+void GeneratePlummerSphere(ParticleSystem& particles, size_t count, uint32_t seed);
+// Central bulge plus a thin exponential disk on circular orbits
+void GenerateDiskGalaxy(ParticleSystem& particles, size_t count, uint32_t seed);
+// The Solar System preset filled up to count bodies with an asteroid belt
+void GenerateSolarSystem(ParticleSystem& particles, size_t count, uint32_t seed);
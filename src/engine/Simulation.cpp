@@ -0,0 +1,92 @@
+#include "Simulation.h"
+
+#include <algorithm>
+
+#include "../utils/Profiler.h"
+
+int Simulation::Advance(double frameTime)
+{
+	// Clamp long frames so a slow step cannot snowball into ever more steps
+	m_Accumulator += std::min(frameTime, MaxSubsteps * FixedStep);
+
+	int steps = 0;
+	while (m_Accumulator >= FixedStep && steps < MaxSubsteps)
+	{
+		m_PrevPositions = Particles.Positions;
+		Step(GetStepSize());
+		m_Accumulator -= FixedStep;
+		steps++;
+	}
+	m_Accumulator = std::min(m_Accumulator, FixedStep);
+	LastSubsteps = steps;
+	return steps;
+}
+
+void Simulation::Step(float SIM_SPEED)
+{
+	PROFILE_SCOPE("Step");
+	m_Time += SIM_SPEED;
+	m_StepCount++;
+	if (Backend)
+	{
+		Backend->Step(Particles, SIM_SPEED, GravityParams);
+		return;
+	}
+	AccelerationFn accelerate = [this](const std::vector<Vec3>& positions, std::vector<glm::vec3>& accelerations)
+	{
+		m_Gravity.ComputeAccelerations(positions, Particles.Masses, GravityParams, accelerations);
+	};
+	if (AdaptiveTimesteps)
+		Blocks.Step(Particles, SIM_SPEED, m_Gravity, GravityParams);
+	else if (Regularize && Scheme == IntegratorScheme::Leapfrog)
+	{
+		// Each keeps its own force cache, which goes stale while the other one runs
+		m_Integrator.Invalidate();
+		Regularizer.Step(Particles.Positions, Particles.Velocities, Particles.Masses, GravityParams.Softening, SIM_SPEED, accelerate);
+	}
+	else
+	{
+		Regularizer.Invalidate();
+		m_Integrator.Step(Scheme, Particles.Positions, Particles.Velocities, SIM_SPEED, accelerate);
+	}
+
+	if (MergeCollisions)
+	{
+		PROFILE_SCOPE("Collisions");
+		// Merged bodies leave the cached forces and the blend source stale
+		if (Collider.Resolve(Particles) > 0)
+			Invalidate();
+	}
+}
+
+void Simulation::Invalidate()
+{
+	m_Integrator.Invalidate();
+	Regularizer.Invalidate();
+	Blocks.Invalidate();
+	m_Revision++;
+	// Blending from the pre-edit positions would smear the edit over a frame
+	m_PrevPositions.clear();
+	if (Backend)
+		Backend->Invalidate();
+}
+
+float Simulation::GetAlpha() const
+{
+	return static_cast<float>(m_Accumulator / FixedStep);
+}
+
+void Simulation::GetRenderPositions(std::vector<Vec3>& positions) const
+{
+	// Bodies added or removed since the last step have no previous state to blend from
+	if (m_PrevPositions.size() != Particles.Size())
+	{
+		positions = Particles.Positions;
+		return;
+	}
+
+	Real alpha = GetAlpha();
+	positions.resize(Particles.Size());
+	for (size_t i = 0; i < positions.size(); i++)
+		positions[i] = glm::mix(m_PrevPositions[i], Particles.Positions[i], alpha);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ParticleSystem.h"
+#include "Gravity.h"
+#include "Integrator.h"
+#include "BlockTimestep.h"
+#include "Collisions.h"
+#include "Regularization.h"
+
+// Steps the simulation somewhere other than the CPU integrators, e.g. on the GPU.
+// Particles stays the backend's view of the state and may lag behind it.
+class SimulationBackend
+{
+public:
+	virtual ~SimulationBackend() = default;
+
+	virtual void Step(ParticleSystem& particles, float dt, const GravitySettings& settings) = 0;
+	// Particles was edited and must be taken over again
+	virtual void Invalidate() = 0;
+};
+
+// Advances the particle system in fixed steps, independent of the render frame rate
+class Simulation
+{
+public:
+	// Consumes frameTime real seconds in FixedStep chunks, returns how many steps ran
+	int Advance(double frameTime);
+	void Step(float SIM_SPEED);
+
+	// Positions blended between the last two steps by the leftover accumulator time
+	void GetRenderPositions(std::vector<Vec3>& positions) const;
+	float GetAlpha() const;
+	float GetStepSize() const { return static_cast<float>((Speed * FixedStep) / 10000); }
+	Gravity& GetGravity() { return m_Gravity; }
+	// Call after editing particle state outside of Step()
+	void Invalidate();
+	// Bumped by Invalidate(), lets caches of the state notice edits
+	uint64_t GetRevision() const { return m_Revision; }
+	// Sum of the step sizes taken so far
+	double GetTime() const { return m_Time; }
+	void SetTime(double time) { m_Time = time; }
+	uint64_t GetStepCount() const { return m_StepCount; }
+
+	ParticleSystem Particles;
+	GravitySettings GravityParams;
+	IntegratorScheme Scheme = IntegratorScheme::Leapfrog;
+	bool AdaptiveTimesteps = false; // per-body block timesteps instead of Scheme
+	BlockTimestep Blocks;
+	bool Regularize = false; // Leapfrog only: tight bound pairs are moved on Kepler orbits
+	Regularization Regularizer;
+	SimulationBackend* Backend = nullptr; // replaces the CPU path when set
+	bool MergeCollisions = false;		  // CPU path only
+	Collisions Collider;
+	float Speed = 1.0f;
+	double FixedStep = 1.0 / 120.0; // real seconds covered by one physics step
+	int MaxSubsteps = 8;			// anything beyond this per frame is dropped
+	int LastSubsteps = 0;
+private:
+	Gravity m_Gravity;
+	Integrator m_Integrator;
+	std::vector<Vec3> m_PrevPositions;
+	double m_Accumulator = 0;
+	double m_Time = 0;
+	uint64_t m_StepCount = 0;
+	uint64_t m_Revision = 0;
+};
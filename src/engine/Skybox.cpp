@@ -84,17 +84,11 @@ Skybox::Skybox(std::vector<std::string> faces)
     m_VBO->Unbind();
 }
 
-void Skybox::Render(Shader& shader, Camera& camera)
+void Skybox::Render(Shader& shader)
 {
-    glm::mat4 view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-    glm::mat4 camMatrix = camera.GetProjectionMatrix() * view;
-
-
     glDepthFunc(GL_LEQUAL);
 	glDepthMask(GL_FALSE);
     shader.Activate();
-	camera.Update(shader, "camMatrix", camMatrix);
-    glUniformMatrix4fv(glGetUniformLocation(shader.ProgramID, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
 
 	m_VAO.Bind();
 	glActiveTexture(GL_TEXTURE0);
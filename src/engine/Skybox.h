@@ -5,7 +5,6 @@
 #include <stb_image.h>
 
 #include "../renderer/Shader.h"
-#include "../renderer/Camera.h"
 #include "../renderer/gl/VAO.h"
 #include "../renderer/gl/VBO.h"
 
@@ -14,7 +13,8 @@ class Skybox
 public:
 	Skybox(std::vector<std::string> filePath);
 
-	void Render(Shader& shader, Camera& camera);
+	// The camera comes from the Frame uniform block; its view matrix only rotates
+	void Render(Shader& shader);
 private:
 	unsigned int m_TextureID;
 	VAO m_VAO;
@@ -0,0 +1,183 @@
+#include "TrajectoryPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Samples integrated between checks for new work and publishes
+static const int BatchSize = 16;
+
+bool TrajectoryPredictor::Params::operator==(const Params& other) const
+{
+	return Revision == other.Revision && Bodies == other.Bodies && Length == other.Length && Scheme == other.Scheme &&
+		Gravity.Solver == other.Gravity.Solver && Gravity.Theta == other.Gravity.Theta && Gravity.Softening == other.Gravity.Softening &&
+		Gravity.FmmOrder == other.Gravity.FmmOrder &&
+		SampleStep == other.SampleStep && Reversed == other.Reversed;
+}
+
+TrajectoryPredictor::~TrajectoryPredictor()
+{
+	Stop();
+}
+
+void TrajectoryPredictor::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Abort = true;
+	m_Wake.notify_all();
+	m_Thread.join();
+	m_Stopping = false;
+	m_Abort = false;
+	m_HasParams = false; // the worker's state is gone, start over on the next Update
+}
+
+void TrajectoryPredictor::Update(const Simulation& simulation, int length)
+{
+	Params params;
+	params.Revision = simulation.GetRevision();
+	params.Bodies = simulation.Particles.Size();
+	params.Length = std::max(length, 1);
+	params.Scheme = simulation.Scheme;
+	params.Gravity = simulation.GravityParams;
+	params.SampleStep = simulation.FixedStep;
+	params.Reversed = simulation.Speed < 0;
+
+	if (!m_Thread.joinable())
+		m_Thread = std::thread(&TrajectoryPredictor::WorkerLoop, this);
+
+	if (!m_HasParams || !(params == m_Params))
+	{
+		Reset(simulation, params);
+		return;
+	}
+
+	// Slide the window past the samples the simulation has already reached
+	double elapsed = (simulation.GetTime() - m_BaseTime) * (params.Reversed ? -1.0 : 1.0);
+	if (elapsed < 0)
+	{
+		Reset(simulation, params);
+		return;
+	}
+	uint64_t first = static_cast<uint64_t>(std::floor(elapsed / params.SampleStep)) + 1;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (first != m_First)
+	{
+		m_First = first;
+		m_Wake.notify_all();
+	}
+}
+
+void TrajectoryPredictor::Reset(const Simulation& simulation, const Params& params)
+{
+	m_Params = params;
+	m_HasParams = true;
+	m_BaseTime = simulation.GetTime();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	const ParticleSystem& particles = simulation.Particles;
+	m_StartPositions = particles.Positions;
+	m_StartVelocities = particles.Velocities;
+	// The preview runs forward in time; a reversed simulation is previewed with flipped velocities
+	if (params.Reversed)
+		for (Vec3& v : m_StartVelocities)
+			v = -v;
+	m_StartMasses = particles.Masses;
+	m_StartParams = params;
+	m_First = 1;
+	m_HasNew = false;
+	m_ResetPending = true;
+	m_Abort = true;
+	m_Wake.notify_all();
+}
+
+bool TrajectoryPredictor::Fetch(TrajectorySet& paths)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!m_HasNew)
+		return false;
+	std::swap(paths, m_Front);
+	m_HasNew = false;
+	return true;
+}
+
+void TrajectoryPredictor::Publish()
+{
+	// Linearize the live part of the ring into the back buffer, then hand it over
+	size_t bodies = m_WorkParams.Bodies;
+	size_t capacity = static_cast<size_t>(m_WorkParams.Length);
+	uint64_t first;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		first = m_First;
+	}
+	first = std::max(first, m_Next > capacity ? m_Next - capacity : uint64_t(1));
+	size_t count = m_Next > first ? static_cast<size_t>(m_Next - first) : 0;
+
+	m_Back.Bodies = bodies;
+	m_Back.Length = count;
+	m_Back.Points.resize(bodies * count);
+	for (size_t b = 0; b < bodies; b++)
+	{
+		const Vec3* ring = &m_Ring[b * capacity];
+		Vec3* out = &m_Back.Points[b * count];
+		for (size_t k = 0; k < count; k++)
+			out[k] = ring[(first + k) % capacity];
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_ResetPending)
+		return; // already stale
+	std::swap(m_Back, m_Front);
+	m_HasNew = true;
+}
+
+void TrajectoryPredictor::WorkerLoop()
+{
+	auto accelerate = [this](const std::vector<Vec3>& positions, std::vector<glm::vec3>& accelerations) {
+		m_Gravity.ComputeAccelerations(positions, m_Masses, m_WorkParams.Gravity, accelerations);
+	};
+
+	while (true)
+	{
+		uint64_t target;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [this] {
+				return m_Stopping || m_ResetPending || m_Next < m_First + m_WorkParams.Length;
+			});
+			if (m_Stopping)
+				return;
+			if (m_ResetPending)
+			{
+				std::swap(m_Positions, m_StartPositions);
+				std::swap(m_Velocities, m_StartVelocities);
+				std::swap(m_Masses, m_StartMasses);
+				m_WorkParams = m_StartParams;
+				m_ResetPending = false;
+				m_Abort = false;
+				m_Next = 1;
+				m_Ring.assign(m_WorkParams.Bodies * m_WorkParams.Length, Vec3(0));
+				m_Integrator.Invalidate();
+			}
+			target = std::min(m_First + m_WorkParams.Length, m_Next + BatchSize);
+		}
+
+		size_t capacity = static_cast<size_t>(m_WorkParams.Length);
+		float dt = static_cast<float>(m_WorkParams.SampleStep);
+		while (m_Next < target && !m_Abort)
+		{
+			m_Integrator.Step(m_WorkParams.Scheme, m_Positions, m_Velocities, dt, accelerate);
+			size_t slot = static_cast<size_t>(m_Next % capacity);
+			for (size_t b = 0; b < m_WorkParams.Bodies; b++)
+				m_Ring[b * capacity + slot] = m_Positions[b];
+			m_Next++;
+		}
+		if (!m_Abort)
+			Publish();
+	}
+}
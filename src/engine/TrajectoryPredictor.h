@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Simulation.h"
+
+// Predicted paths of every body, body-major: Points[body * Length + sample]
+struct TrajectorySet
+{
+	size_t Bodies = 0;
+	size_t Length = 0;
+	std::vector<Vec3> Points;
+};
+
+// Predicts body paths on a background thread. Samples are FixedStep of simulation
+// time apart and kept in a ring buffer: as the simulation moves on, samples it has
+// passed are dropped and new ones are integrated at the far end, so the full path
+// is only recomputed after an edit (Simulation::Invalidate) or a settings change.
+class TrajectoryPredictor
+{
+public:
+	~TrajectoryPredictor();
+
+	// Call once per frame from the thread that owns the simulation
+	void Update(const Simulation& simulation, int length);
+	// Swaps in the newest finished paths; false if nothing changed since the last call
+	bool Fetch(TrajectorySet& paths);
+	// Joins the worker, e.g. before resizing the thread pool it shares; Update restarts it
+	void Stop();
+private:
+	// Everything that, when changed, makes the cached samples useless
+	struct Params
+	{
+		uint64_t Revision = 0;
+		size_t Bodies = 0;
+		int Length = 0;
+		IntegratorScheme Scheme = IntegratorScheme::Leapfrog;
+		GravitySettings Gravity;
+		double SampleStep = 0;
+		bool Reversed = false;
+
+		bool operator==(const Params& other) const;
+	};
+
+	void Reset(const Simulation& simulation, const Params& params);
+	void WorkerLoop();
+	void Publish();
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	bool m_Stopping = false;
+
+	// Main thread only
+	Params m_Params;
+	double m_BaseTime = 0;
+	bool m_HasParams = false;
+
+	// Shared, guarded by m_Mutex
+	bool m_ResetPending = false;
+	std::vector<Vec3> m_StartPositions, m_StartVelocities;
+	std::vector<double> m_StartMasses;
+	Params m_StartParams;
+	uint64_t m_First = 1; // oldest sample still ahead of the simulation
+	TrajectorySet m_Front;
+	bool m_HasNew = false;
+	std::atomic<bool> m_Abort{ false };
+
+	// Worker only
+	Params m_WorkParams;
+	std::vector<Vec3> m_Positions, m_Velocities;
+	std::vector<double> m_Masses;
+	std::vector<Vec3> m_Ring; // body-major, sample k lives in slot k % Length
+	uint64_t m_Next = 1;		   // next sample to integrate; sample 0 is the start state
+	Gravity m_Gravity;
+	Integrator m_Integrator;
+	TrajectorySet m_Back;
+};
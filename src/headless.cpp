@@ -0,0 +1,224 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "engine/Simulation.h"
+#include "engine/Scenario.h"
+#include "engine/Checkpoint.h"
+#include "engine/Recording.h"
+#include "utils/ThreadPool.h"
+#include "utils/Profiler.h"
+
+// Runs a scenario without a window or GL context and writes body states to disk
+
+static void PrintUsage()
+{
+	std::cout <<
+		"usage: UniverseHeadless [options]\n"
+		"  --scenario <name>   preset to load (default \"Solar System\")\n"
+		"  --load <file>       resume from a checkpoint; options after it override its settings\n"
+		"  --save <file>       write a checkpoint after the last step\n"
+		"  --steps <n>         number of physics steps (default 10000)\n"
+		"  --speed <s>         simulation speed, as in the Tools window (default 1)\n"
+		"  --step-ms <ms>      real time covered by one step (default 8.333)\n"
+		"  --solver <name>     direct | barnes-hut | simd | fmm (default barnes-hut)\n"
+		"  --theta <t>         Barnes-Hut / FMM opening angle (default 0.5)\n"
+		"  --fmm-order <p>     FMM expansion order, 1 to 8 (default 4)\n"
+		"  --softening <eps>   Plummer softening length (default 0)\n"
+		"  --integrator <name> euler | leapfrog | verlet | yoshida4 | rk4 (default leapfrog)\n"
+		"  --adaptive <levels> per-body block timesteps with up to 2^levels substeps\n"
+		"  --regularize <r>    leapfrog only: move bound pairs closer than r on Kepler orbits\n"
+		"  --collisions <0|1>  merge bodies that touch (default 0)\n"
+		"  --threads <n>       worker threads, 0 = all cores (default 0)\n"
+		"  --output <file>     CSV file to write (default headless.csv)\n"
+		"  --every <k>         also write a frame every k steps (default: final state only)\n"
+		"  --record <file>     stream a replayable recording of the run\n"
+		"  --record-every <k>  steps between recorded frames (default 10)\n"
+		"  --profile <file>    time every step and write a Chrome trace of the last ones\n";
+}
+
+static void WriteFrame(std::ofstream& out, const ParticleSystem& particles, long long step)
+{
+	for (size_t i = 0; i < particles.Size(); i++)
+	{
+		const Vec3& p = particles.Positions[i];
+		const Vec3& v = particles.Velocities[i];
+		out << step << ',' << i << ',' << p.x << ',' << p.y << ',' << p.z << ','
+			<< v.x << ',' << v.y << ',' << v.z << ',' << particles.Masses[i] << '\n';
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string scenario = "Solar System";
+	std::string output = "headless.csv";
+	std::string checkpoint;
+	std::string recording;
+	std::string profile;
+	int recordEvery = 10;
+	bool loaded = false;
+	long long steps = 10000;
+	long long every = 0;
+	unsigned int threads = 0;
+	Simulation simulation;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (arg == "--help" || arg == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		if (!value)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return -1;
+		}
+		i++;
+
+		if (arg == "--scenario")
+			scenario = value;
+		else if (arg == "--load")
+		{
+			if (!LoadCheckpoint(value, simulation))
+				return -1;
+			scenario = value;
+			loaded = true;
+		}
+		else if (arg == "--save")
+			checkpoint = value;
+		else if (arg == "--steps")
+			steps = std::atoll(value);
+		else if (arg == "--speed")
+			simulation.Speed = static_cast<float>(std::atof(value));
+		else if (arg == "--step-ms")
+			simulation.FixedStep = std::atof(value) / 1000.0;
+		else if (arg == "--theta")
+			simulation.GravityParams.Theta = static_cast<float>(std::atof(value));
+		else if (arg == "--fmm-order")
+			simulation.GravityParams.FmmOrder = std::atoi(value);
+		else if (arg == "--softening")
+			simulation.GravityParams.Softening = static_cast<float>(std::atof(value));
+		else if (arg == "--regularize")
+		{
+			simulation.Regularize = true;
+			simulation.Regularizer.Radius = static_cast<float>(std::atof(value));
+		}
+		else if (arg == "--adaptive")
+		{
+			simulation.AdaptiveTimesteps = true;
+			simulation.Blocks.MaxLevel = std::atoi(value);
+		}
+		else if (arg == "--collisions")
+			simulation.MergeCollisions = std::atoi(value) != 0;
+		else if (arg == "--threads")
+			threads = static_cast<unsigned int>(std::atoi(value));
+		else if (arg == "--output")
+			output = value;
+		else if (arg == "--every")
+			every = std::atoll(value);
+		else if (arg == "--record")
+			recording = value;
+		else if (arg == "--record-every")
+			recordEvery = std::atoi(value);
+		else if (arg == "--profile")
+			profile = value;
+		else if (arg == "--integrator")
+		{
+			if (std::strcmp(value, "euler") == 0)
+				simulation.Scheme = IntegratorScheme::Euler;
+			else if (std::strcmp(value, "leapfrog") == 0)
+				simulation.Scheme = IntegratorScheme::Leapfrog;
+			else if (std::strcmp(value, "verlet") == 0)
+				simulation.Scheme = IntegratorScheme::VelocityVerlet;
+			else if (std::strcmp(value, "yoshida4") == 0)
+				simulation.Scheme = IntegratorScheme::Yoshida4;
+			else if (std::strcmp(value, "rk4") == 0)
+				simulation.Scheme = IntegratorScheme::RK4;
+			else
+			{
+				std::cerr << "Unknown integrator: " << value << std::endl;
+				return -1;
+			}
+		}
+		else if (arg == "--solver")
+		{
+			if (std::strcmp(value, "direct") == 0)
+				simulation.GravityParams.Solver = GravitySolver::Direct;
+			else if (std::strcmp(value, "barnes-hut") == 0)
+				simulation.GravityParams.Solver = GravitySolver::BarnesHut;
+			else if (std::strcmp(value, "simd") == 0)
+				simulation.GravityParams.Solver = GravitySolver::DirectSimd;
+			else if (std::strcmp(value, "fmm") == 0)
+				simulation.GravityParams.Solver = GravitySolver::Fmm;
+			else
+			{
+				std::cerr << "Unknown solver: " << value << std::endl;
+				return -1;
+			}
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+			PrintUsage();
+			return -1;
+		}
+	}
+
+	if (!loaded && !LoadScenario(scenario, simulation.Particles))
+	{
+		std::cerr << "Unknown scenario: " << scenario << std::endl;
+		return -1;
+	}
+	ThreadPool::Get().Resize(threads);
+
+	std::ofstream out(output);
+	if (!out)
+	{
+		std::cerr << "Error opening file: " << output << std::endl;
+		return -1;
+	}
+	out.precision(9);
+	out << "step,body,x,y,z,vx,vy,vz,mass\n";
+
+	Recorder recorder;
+	if (!recording.empty() && !recorder.Start(recording, recordEvery))
+		return -1;
+	recorder.Capture(simulation);
+
+	Profiler& profiler = Profiler::Get();
+	profiler.SetEnabled(!profile.empty());
+
+	const float stepSize = simulation.GetStepSize();
+	auto start = std::chrono::steady_clock::now();
+	for (long long step = 1; step <= steps; step++)
+	{
+		profiler.BeginFrame();
+		simulation.Step(stepSize);
+		recorder.Capture(simulation);
+		profiler.EndFrame();
+		if (every > 0 && step % every == 0 && step != steps)
+			WriteFrame(out, simulation.Particles, step);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	WriteFrame(out, simulation.Particles, steps);
+	recorder.Stop();
+	if (!profile.empty() && !profiler.ExportChromeTrace(profile))
+		return -1;
+	if (!checkpoint.empty() && !SaveCheckpoint(checkpoint, simulation))
+		return -1;
+
+	std::printf("scenario: %s, bodies: %zu, steps: %lld, integrator: %s, threads: %u\n",
+		scenario.c_str(), simulation.Particles.Size(), steps, GetIntegratorName(simulation.Scheme), ThreadPool::Get().GetThreadCount());
+	if (simulation.MergeCollisions)
+		std::printf("merged bodies: %llu\n", static_cast<unsigned long long>(simulation.Collider.GetMergeCount()));
+	std::printf("%.3f s, %.1f steps/s, %.3e body-steps/s\n",
+		seconds, steps / seconds, steps * double(simulation.Particles.Size()) / seconds);
+	return 0;
+}
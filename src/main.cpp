@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <optional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -14,31 +16,41 @@
 #include "renderer/gl/VAO.h"
 #include "renderer/gl/VBO.h"
 #include "renderer/gl/EBO.h"
+#include "renderer/gl/StreamBuffer.h"
 #include "renderer/Camera.h"
 
 #include "engine/Body.h"
+#include "engine/ParticleSystem.h"
 #include "engine/Skybox.h"
 #include "engine/Grid.h"
+#include "engine/Gravity.h"
+#include "engine/Simulation.h"
+#include "engine/Integrator.h"
+#include "engine/Scenario.h"
+#include "engine/GpuNBody.h"
+#include "engine/TrajectoryPredictor.h"
+#include "engine/Checkpoint.h"
+#include "engine/Recording.h"
 #include "renderer/LineRenderer.h"
-
-struct Snapshot {
-	glm::vec3 pos, vel, color;
-	double mass;
-};
-
-inline glm::vec3 computeForce(Snapshot a, Snapshot b)
-{
-	const double G = 6.67430e-11; // Universal gravitation constant
-	glm::vec3 direction = glm::normalize(b.pos - a.pos);
-	float magnitude = static_cast<float>(G * ((a.mass * b.mass) / pow(glm::distance(a.pos, b.pos), 2)));
-	return direction * magnitude;
-}
+#include "renderer/FrameUniforms.h"
+#include "renderer/BodyRenderer.h"
+#include "renderer/GpuProfiler.h"
+#include "renderer/ProfilerOverlay.h"
+#include "utils/ThreadPool.h"
+#include "utils/Profiler.h"
 
 int WIDTH = 1366;
 int HEIGHT = 720;
 static bool f11PressedLastFrame = false;
 
-int main()
+// Edits a simulation vector in whatever precision Real is
+static bool InputVec3(const char* label, Vec3& value)
+{
+	ImGuiDataType type = sizeof(Real) == sizeof(double) ? ImGuiDataType_Double : ImGuiDataType_Float;
+	return ImGui::InputScalarN(label, type, glm::value_ptr(value), 3);
+}
+
+int main(int argc, char** argv)
 {
 	if (!glfwInit())
 	{
@@ -76,6 +88,7 @@ int main()
 	glFrontFace(GL_CCW);
 
 	bool toolActive = true;
+	bool showProfiler = false;
 
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -85,15 +98,22 @@ int main()
 	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
 	ImGui_ImplOpenGL3_Init();
 
-	Camera camera(WIDTH, HEIGHT, glm::vec3(0.0f, 0.0f, 0.0f), 80.0f, 0.1f, 500000.0f);
+	Camera camera(WIDTH, HEIGHT, Vec3(0), 80.0f, 0.1f, 500000.0f);
 	Shader shader("assets/shaders/default-vert.glsl", "assets/shaders/default-frag.glsl");
 	Shader lightShader("assets/shaders/light-vert.glsl", "assets/shaders/light-frag.glsl");
+	Shader impostorShader("assets/shaders/impostor-vert.glsl", "assets/shaders/impostor-frag.glsl");
+	Shader pointShader("assets/shaders/point-vert.glsl", "assets/shaders/point-frag.glsl");
 	Shader skyboxShader("assets/shaders/skybox-vert.glsl", "assets/shaders/skybox-frag.glsl");
 	Shader debugShader("assets/shaders/debug-vert.glsl", "assets/shaders/debug-frag.glsl");
-
-	std::vector<Snapshot> snaps;
-	std::vector<std::vector<GLfloat>> trajectoryVerts = { {0,0,0, 0,100,0}, {0,0,0,0,0,100} };
-	LineRenderer trajectoryLine(trajectoryVerts[0]);
+	Shader lineShader("assets/shaders/line-vert.glsl", "assets/shaders/line-frag.glsl");
+	Shader gridShader("assets/shaders/grid-vert.glsl", "assets/shaders/debug-frag.glsl");
+	Shader gridReduceShader("assets/shaders/grid-reduce-comp.glsl");
+
+	TrajectoryPredictor trajectoryPredictor;
+	TrajectorySet trajectories;
+	std::vector<GLfloat> trajectoryVerts;
+	std::vector<GLsizei> trajectoryCounts;
+	LineRenderer trajectoryLines;
 	int trajectorySize = 100;
 
 	std::vector<std::string> faces = 
@@ -106,29 +126,53 @@ int main()
 		"assets/textures/skybox_back.png"
 	};
 
-	float SIM_SPEED = 1;
 	bool SHOW_GRID = true;
 	bool GRID_FOLLOWS_CAMERA = true;
-	glm::vec3 bodyCameraOffset = glm::vec3();
+	Vec3 bodyCameraOffset = Vec3(0);
 	float GRID_SIZE = 20000;
 	int GRID_DIVS = 100;
 	bool SHOW_SKYBOX = true;
 	bool SHOW_TRAJECTORIES = true;
 
-	std::vector<Body*> bodies = {};
+	Simulation simulation;
+	ParticleSystem& particles = simulation.Particles;
+	std::vector<Vec3> renderPositions;
+	std::vector<uint32_t> mergeRemap;
+	float gravityError = -1;
+	char checkpointPath[256] = "universe.ckpt";
+	std::string checkpointStatus;
+	Recorder recorder;
+	Replay replay;
+	char recordingPath[256] = "universe.rec";
+	int recordEvery = 10;
+	std::string recordingStatus;
+	int replayFrame = 0;
+	int replayShownFrame = -1;
+	uint64_t replayRevision = 0;
+	bool replayPlaying = false;
+	float replayRate = 30.0f; // frames per second
+	double replayClock = 0;
 	int selectedBody = -1;
 	int lightBody = 0;
 	int trackingBody = -1;
 	int followingBody = -1;
 
-	glm::vec3 ambientLight = glm::vec3();
-	shader.Activate();
-	glUniform3fv(glGetUniformLocation(shader.ProgramID, "uAmbientLight"), 1, glm::value_ptr(ambientLight));
-	auto locLightPos = glGetUniformLocation(shader.ProgramID, "uLightPos");
-	auto locLightColor = glGetUniformLocation(shader.ProgramID, "uLightColor");
+	FrameUniforms frameUniforms;
+
+	// Universe <checkpoint> resumes a saved run
+	if (argc > 1)
+	{
+		snprintf(checkpointPath, sizeof(checkpointPath), "%s", argv[1]);
+		if (!LoadCheckpoint(argv[1], simulation))
+			checkpointStatus = "Failed to load " + std::string(argv[1]);
+	}
 
 	Skybox skybox(faces);
+	BodyRenderer bodyRenderer;
 	Grid grid(GRID_SIZE, GRID_DIVS);
+	GpuNBody gpuPhysics;
+	GpuProfiler gpuProfiler;
+	ProfilerOverlay profilerOverlay;
 
 	glfwSetWindowUserPointer(window, &camera);
 	glfwSetScrollCallback(window, [](GLFWwindow* window, double xoffset, double yoffset)
@@ -151,6 +195,8 @@ int main()
 		currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
+		Profiler::Get().BeginFrame();
+		gpuProfiler.BeginFrame();
 
 		camera.HandleInput(window, deltaTime);
 		if (glfwGetKey(window, GLFW_KEY_F11) == GLFW_PRESS && !f11PressedLastFrame) {
@@ -170,96 +216,136 @@ int main()
 		glClearColor(0.0f, 0.0f, 0.0f, 255.0f);
 		camera.UpdateMatrix();
 
-		if (selectedBody > bodies.size())
+		if (selectedBody >= (int)particles.Size())
 			selectedBody = -1;
 
-		shader.Activate();
-		if (lightBody >= 0 && !bodies.empty() && lightBody < bodies.size()) {
-			glUniform3fv(locLightPos, 1, glm::value_ptr(bodies[lightBody]->Position));
-			glUniform3fv(locLightColor, 1, glm::value_ptr(bodies[lightBody]->Color));
+		GLuint bodyBuffer = 0;
+		{
+			GpuProfileScope profile(gpuProfiler, "Physics");
+			if (replay.IsOpen())
+			{
+				// Playback feeds recorded states straight into the bodies; no physics runs
+				int lastFrame = static_cast<int>(replay.GetFrameCount()) - 1;
+				// The UI moved the frame since it was shown: a scrub or seek, not playback
+				bool seeked = replayFrame != replayShownFrame;
+				if (replayPlaying)
+				{
+					replayClock += deltaTime * replayRate;
+					int frames = static_cast<int>(replayClock);
+					replayClock -= frames;
+					replayFrame = std::min(replayFrame + frames, lastFrame);
+					if (replayFrame == lastFrame)
+						replayPlaying = false;
+				}
+				if (replayFrame != replayShownFrame && replay.ReadFrame(replayFrame, particles))
+				{
+					// Forward playback lets the trajectory predictor slide with the time;
+					// a seek or a new body set restarts it and the integrators
+					simulation.SetTime(replay.GetFrameTime(replayFrame));
+					if (seeked || replay.GetRevision() != replayRevision)
+					{
+						replayRevision = replay.GetRevision();
+						simulation.Invalidate();
+					}
+					replayShownFrame = replayFrame;
+				}
+			}
+			else
+			{
+				simulation.Advance(deltaTime);
+				// The GPU backend's state reaches the CPU a frame late; rendering reads its buffers instead
+				if (simulation.Backend == &gpuPhysics)
+				{
+					gpuPhysics.Sync(particles);
+					if (gpuPhysics.GetCount() == particles.Size())
+						bodyBuffer = gpuPhysics.GetPositionBuffer();
+				}
+				recorder.Capture(simulation);
+				// Keep the UI on the same bodies when they were merged or shifted down
+				if (simulation.Collider.TakeRemap(mergeRemap))
+				{
+					for (int* body : { &selectedBody, &lightBody, &trackingBody, &followingBody })
+						if (*body >= 0 && *body < static_cast<int>(mergeRemap.size()))
+							*body = static_cast<int>(mergeRemap[*body]);
+				}
+			}
+		}
+		simulation.GetRenderPositions(renderPositions);
+
+		if (lightBody >= 0 && lightBody < particles.Size()) {
+			frameUniforms.LightPosition = renderPositions[lightBody];
+			frameUniforms.LightColor = particles.Colors[lightBody];
 		}
 		else {
-			glUniform3fv(locLightPos, 1, glm::value_ptr(glm::vec3()));
-			glUniform3fv(locLightColor, 1, glm::value_ptr(glm::vec3(1,1,1)));
+			frameUniforms.LightPosition = Vec3(0);
+			frameUniforms.LightColor = glm::vec3(1,1,1);
 		}
+		frameUniforms.Update(camera);
 
 		if(SHOW_SKYBOX)
-			skybox.Render(skyboxShader, camera);
-
-		for (Body* body : bodies)
 		{
-			for (Body* other : bodies)
-			{
-				if (body == other || body->Mass == 0)
-					continue;
-				glm::vec3 force = body->GetForce(*other);
-				body->Accelerate(force, (SIM_SPEED * deltaTime) / 10000);
-			}
+			GpuProfileScope profile(gpuProfiler, "Skybox");
+			skybox.Render(skyboxShader);
+		}
 
-			body->Update((SIM_SPEED* deltaTime) / 10000);
-			body->Render(body->Glows ? lightShader : shader, camera);
+		{
+			GpuProfileScope profile(gpuProfiler, "Bodies");
+			bodyRenderer.Render(particles, renderPositions, shader, lightShader, impostorShader, pointShader, camera, bodyBuffer);
 		}
 
 		if (SHOW_GRID)
 		{
-			grid.Update(bodies, GRID_FOLLOWS_CAMERA ? glm::floor(camera.Position / (GRID_SIZE / GRID_DIVS)) * (GRID_SIZE / GRID_DIVS) : glm::vec3());
-			grid.Render(debugShader, camera);
+			GpuProfileScope profile(gpuProfiler, "Grid");
+			Real cell = Real(GRID_SIZE) / GRID_DIVS;
+			grid.Update(particles, GRID_FOLLOWS_CAMERA ? glm::floor(camera.Position / cell) * cell : Vec3(0), camera, gridReduceShader, bodyBuffer);
+			grid.Render(gridShader);
 		}
 
 
-		if (trackingBody >= 0 && !bodies.empty() && trackingBody < bodies.size())
-			camera.LookAt(bodies[trackingBody]->Position);
+		if (trackingBody >= 0 && trackingBody < particles.Size())
+			camera.LookAt(renderPositions[trackingBody]);
 		else
 			trackingBody = -1;
 		
-		if (followingBody >= 0 && !bodies.empty() && followingBody < bodies.size())
-			camera.Position = bodies[followingBody]->Position - bodyCameraOffset;
+		if (followingBody >= 0 && followingBody < particles.Size())
+			camera.Position = renderPositions[followingBody] - bodyCameraOffset;
 		else
 			followingBody = -1;
 
 #pragma region trajectory
 		if (SHOW_TRAJECTORIES)
 		{
-			snaps.clear();
-			trajectoryVerts.clear();
-			trajectoryVerts.assign(bodies.size(), std::vector<GLfloat>());
-			for (auto& v : trajectoryVerts)
-				v.reserve(trajectorySize * 3);
-			for (auto& b : bodies)
-				snaps.push_back({ b->Position, b->Velocity * ((SIM_SPEED < 0) ? -1.0f : 1.0f), b->Color, b->Mass });
-
-			for (int step = 0; step < trajectorySize; ++step) {
-				// Compute forces on snaps[i] from snaps[j]
-				std::vector<glm::vec3> acc(snaps.size());
-				for (int i = 0; i < snaps.size(); ++i) {
-					glm::vec3 f{ 0 };
-					for (int j = 0; j < snaps.size(); ++j) if (i != j)
-						f += computeForce(snaps[i], snaps[j]);
-					acc[i] = f / static_cast<float>(snaps[i].mass);
+			GpuProfileScope profile(gpuProfiler, "Trajectories");
+			// Paths come from the background predictor; only the newest finished set is drawn
+			trajectoryPredictor.Update(simulation, trajectorySize);
+			trajectoryPredictor.Fetch(trajectories);
+			size_t bodies = trajectories.Bodies == particles.Size() ? trajectories.Bodies : 0;
+			size_t length = trajectories.Length + 1;
+			trajectoryVerts.resize(bodies * length * LineRenderer::VertexFloats);
+			trajectoryCounts.assign(bodies, GLsizei(length));
+			ThreadPool::Get().ParallelFor(0, bodies, 64, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					GLfloat* verts = &trajectoryVerts[i * length * LineRenderer::VertexFloats];
+					const glm::vec3& color = particles.Colors[i];
+					for (size_t k = 0; k < length; ++k) {
+						// Start the line at the body so it does not lag a sample behind
+						glm::vec3 pos = camera.GetRelative(k == 0 ? renderPositions[i] : trajectories.Points[i * trajectories.Length + k - 1]);
+						float age = length > 1 ? float(k) / float(length - 1) : 0.0f;
+						GLfloat vertex[] = { pos.x, pos.y, pos.z, color.r, color.g, color.b, age };
+						std::copy(vertex, vertex + LineRenderer::VertexFloats, verts + k * LineRenderer::VertexFloats);
+					}
 				}
-				// Integrate (e.g. Verlet or RK4) on snaps[*]
-				for (int i = 0; i < snaps.size(); ++i) {
-					// Example: simple semi-implicit Euler
-					snaps[i].vel += acc[i] * (float)deltaTime;
-					snaps[i].pos += snaps[i].vel * (float)deltaTime;
-					// Store for rendering
-					trajectoryVerts[i].push_back(snaps[i].pos.x);
-					trajectoryVerts[i].push_back(snaps[i].pos.y);
-					trajectoryVerts[i].push_back(snaps[i].pos.z);
-					trajectoryVerts[i].push_back(snaps[i].color.r);
-					trajectoryVerts[i].push_back(snaps[i].color.g);
-					trajectoryVerts[i].push_back(snaps[i].color.b);
-				}
-			}
-			for (auto& verts : trajectoryVerts)
-			{
-				trajectoryLine.Update(verts);
-				trajectoryLine.Render(debugShader, camera);
-			}
+			});
+			// All paths go up in one upload and one multi-draw
+			trajectoryLines.Update(trajectoryVerts, trajectoryCounts);
+			trajectoryLines.Render(lineShader);
 		}
 #pragma endregion
 
 #pragma region ImGui
+		// The UI code is not one block, so its scope is closed by hand after the draw
+		std::optional<GpuProfileScope> imguiProfile;
+		imguiProfile.emplace(gpuProfiler, "ImGui");
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
@@ -270,121 +356,84 @@ int main()
 		{
 			if (ImGui::BeginMenu("Presets"))
 			{
-				if (ImGui::MenuItem("Solar System")) {
-					bodies = {
-						// POSITION, VELOCITY, MASS, RADIUS, COLOR
-						//SUN
-						new Body(glm::vec3(0.0f, 0.0f, 0.0f),
-							glm::vec3(0.0f, 0.0f, 0.0f),
-							1.989e25,
-							1414,
-							glm::vec3(1.0f, 0.0f, 0.0f),
-							true),
-							//mars
-							new Body(glm::vec3(-3000.0f, 650.0f, 0.0f),
-								glm::vec3(0.0f, 0.0f, 500.0f),
-								5.97219e23,
-								5515,
-								glm::vec3(1.0f, 0.25f, 0.56f)),
-								//earth
-								new Body(glm::vec3(5000.0f, 650.0f, 0.0f),
-									glm::vec3(0.0f, 0.0f, -500.0f),
-									5.97219e23,
-									5515,
-									glm::vec3(0.0f, 1.0f, 1.0f)),
-									//moon
-									new Body(glm::vec3(5250.0f, 650.0f, 0.0f),
-										glm::vec3(0.0f, 0.0f, -50.0f),
-										5.97219e21,
-										5515,
-										glm::vec3(1.0f, 1.0f, 1.0f)),
-
-										//Jupiter
-										new Body(glm::vec3(0.0f, 500.0f, 9000.0f),
-											glm::vec3(-500.0f, 50.0f, 0.0f),
-											5.97219 * pow(10, 23.5),
-											5515,
-											glm::vec3(1.0f, 0.5f, 0.15f)),
-										new Body(glm::vec3(0.0f, 550.0f, 9500.0f),
-											glm::vec3(0.0f, 0.0f, -50.0f),
-											5.97219e21,
-											5515,
-											glm::vec3(1.0f, 1.0f, 1.0f)),
-										new Body(glm::vec3(0.0f, 450.0f, 8500.0f),
-											glm::vec3(0.0f, 0.0f, -50.0f),
-											5.97219e21,
-											5515,
-											glm::vec3(1.0f, 1.0f, 1.0f)),
-										new Body(glm::vec3(100.0f, 500.0f, 9000.0f),
-											glm::vec3(50.0f, 0.0f, 0.0f),
-											5.97219e21,
-											5515,
-											glm::vec3(1.0f, 1.0f, 1.0f)),
-
-											//Neptune
-											new Body(glm::vec3(0.0f, -500.0f, -10500.0f),
-												glm::vec3(-350.0f, 50.0f, 0.0f),
-												5.97219 * pow(10, 23.5),
-												5515,
-												glm::vec3(0.35f, 0.5f, 0.15f)),
-											new Body(glm::vec3(350.0f, -450.0f, -10500.0f),
-												glm::vec3(0.0f, 0.0f, -550.0f),
-												5.97219e21,
-												5515,
-												glm::vec3(1.0f, 1.0f, 1.0f)),
-											new Body(glm::vec3(-350.0f, 450.0f, -10500.0f),
-												glm::vec3(0.0f, 0.0f, -550.0f),
-												5.97219e21,
-												5515,
-												glm::vec3(1.0f, 1.0f, 1.0f)),
-											new Body(glm::vec3(0.0f, -450.0f, -10500.0f),
-												glm::vec3(-550.0f, 0.0f, 0.0f),
-												5.97219e21,
-												5515,
-												glm::vec3(1.0f, 1.0f, 1.0f)),
-					};
-					selectedBody = -1;
-				}
-				if (ImGui::MenuItem("Stable Orbit")) {
-					bodies = {
-						new Body(glm::vec3(), glm::vec3(), 1e20, 1, glm::vec3(1,1,1), true),
-						new Body(glm::vec3(1000, 0, 0), glm::vec3(0, 0, -3000), 1e18, 1, glm::vec3(0,0,1))
-					};
-					selectedBody = -1;
-				}
-				if (ImGui::MenuItem("Dynamic Orbit")) {
-					bodies = {
-						new Body(glm::vec3(), glm::vec3(0, 1000, 0), 1e20, 1, glm::vec3(1,1,1), true),
-						new Body(glm::vec3(1000, 0, 0), glm::vec3(0, 0, -3000), 1e18, 1, glm::vec3(0,0,1))
-					};
-					selectedBody = -1;
-				}
-				if (ImGui::MenuItem("Spinny Orbit")) {
-					bodies = {
-						new Body(glm::vec3(), glm::vec3(0, 1000, 0), 1e20, 1411, glm::vec3(1,1,1), true),
-						new Body(glm::vec3(200, 200, -200), glm::vec3(0, 0, 7500), 1e20, 1411, glm::vec3(0,0,1))
-					};
-					selectedBody = -1;
-				}
-				if (ImGui::MenuItem("Blackhole orbit")) {
-					bodies = {
-						new Body(glm::vec3(), glm::vec3(0, 10000, 0), 1e22, 3000, glm::vec3(1,1,1), true),
-						new Body(glm::vec3(0, 250, 2500), glm::vec3(0, -10000, 0), 1e22, 3000, glm::vec3(1,1,1), true)
-					};
-					selectedBody = -1;
-				}
-				if (ImGui::MenuItem("Empty")) {
-					bodies = {};
-					selectedBody = -1;
+				for (const std::string& name : GetScenarioNames())
+				{
+					if (ImGui::MenuItem(name.c_str())) {
+						LoadScenario(name, particles);
+						simulation.Invalidate();
+						selectedBody = -1;
+					}
 				}
 				ImGui::EndMenu();
 			}
+			if (ImGui::BeginMenu("View"))
+			{
+				ImGui::MenuItem("Profiler", nullptr, &showProfiler);
+				ImGui::EndMenu();
+			}
 			ImGui::EndMenuBar();
 		}
 
 		ImGui::Text("General Options");
-		ImGui::InputFloat("Simulation Speed", &SIM_SPEED);
-		ImGui::InputFloat3("Camera Position", glm::value_ptr(camera.Position));
+		ImGui::InputFloat("Simulation Speed", &simulation.Speed);
+		float fixedStepMs = static_cast<float>(simulation.FixedStep * 1000.0);
+		if (ImGui::InputFloat("Physics Step (ms)", &fixedStepMs, 1, 5) && fixedStepMs > 0.1f)
+			simulation.FixedStep = fixedStepMs / 1000.0;
+		ImGui::InputInt("Max Substeps", &simulation.MaxSubsteps);
+		if (simulation.MaxSubsteps < 1)
+			simulation.MaxSubsteps = 1;
+		ImGui::Text("Substeps this frame: %d", simulation.LastSubsteps);
+		const char* backends[] = { "CPU", "GPU (compute shaders)" };
+		int backend = simulation.Backend == &gpuPhysics ? 1 : 0;
+		if (ImGui::Combo("Physics Backend", &backend, backends, IM_ARRAYSIZE(backends)))
+		{
+			if (backend == 1)
+				simulation.Backend = &gpuPhysics;
+			else
+			{
+				gpuPhysics.Download(particles);
+				simulation.Backend = nullptr;
+			}
+			simulation.Invalidate();
+		}
+		if (simulation.Backend == &gpuPhysics)
+			ImGui::Text("GPU backend: all-pairs gravity, leapfrog");
+		const char* schemes[] = {
+			GetIntegratorName(IntegratorScheme::Euler), GetIntegratorName(IntegratorScheme::Leapfrog),
+			GetIntegratorName(IntegratorScheme::VelocityVerlet), GetIntegratorName(IntegratorScheme::Yoshida4),
+			GetIntegratorName(IntegratorScheme::RK4)
+		};
+		int scheme = static_cast<int>(simulation.Scheme);
+		if (ImGui::Combo("Integrator", &scheme, schemes, IM_ARRAYSIZE(schemes)))
+		{
+			simulation.Scheme = static_cast<IntegratorScheme>(scheme);
+			simulation.Invalidate();
+		}
+		if (ImGui::Checkbox("Adaptive Timesteps", &simulation.AdaptiveTimesteps))
+			simulation.Invalidate();
+		ImGui::Checkbox("Regularize Close Pairs", &simulation.Regularize);
+		if (simulation.Regularize)
+		{
+			ImGui::SameLine();
+			if (simulation.Scheme == IntegratorScheme::Leapfrog && !simulation.AdaptiveTimesteps)
+				ImGui::Text("%zu pairs", simulation.Regularizer.GetPairs().size());
+			else
+				ImGui::Text("(fixed-step leapfrog only)");
+			ImGui::SliderFloat("Pair Radius", &simulation.Regularizer.Radius, 0.0f, 5000.0f);
+		}
+		ImGui::Checkbox("Merge Collisions", &simulation.MergeCollisions);
+		if (simulation.MergeCollisions)
+		{
+			ImGui::SameLine();
+			ImGui::Text("%llu merged", static_cast<unsigned long long>(simulation.Collider.GetMergeCount()));
+		}
+		if (simulation.AdaptiveTimesteps)
+		{
+			ImGui::SliderInt("Max Level", &simulation.Blocks.MaxLevel, 0, 12);
+			ImGui::SliderFloat("Accuracy (eta)", &simulation.Blocks.Eta, 0.001f, 0.2f, "%.3f");
+			ImGui::Text("Deepest level: %d, force evaluations: %zu", simulation.Blocks.GetDeepestLevel(), simulation.Blocks.GetForceEvaluations());
+		}
+		InputVec3("Camera Position", camera.Position);
 		ImGui::Checkbox("Show Grid", &SHOW_GRID);
 		ImGui::Checkbox("Grid Follows Camera", &GRID_FOLLOWS_CAMERA);
 		if (ImGui::InputFloat("Grid Size", &GRID_SIZE, 10, 100))
@@ -392,26 +441,139 @@ int main()
 		if (ImGui::InputInt("Grid Divisions", &GRID_DIVS, 5, 10))
 			grid.Update(GRID_SIZE, GRID_DIVS);
 		ImGui::Checkbox("Show Skybox", &SHOW_SKYBOX);
+		ImGui::SliderFloat("Body Detail", &bodyRenderer.DetailScale, 0.25f, 4.0f);
+		ImGui::Checkbox("Impostors", &bodyRenderer.UseImpostors);
+		if (bodyRenderer.UseImpostors)
+			ImGui::SliderFloat("Impostor Pixels", &bodyRenderer.ImpostorPixels, BodyRenderer::LevelPixels[BodyRenderer::Levels - 1], 64.0f);
+		ImGui::Text("Bodies per detail level: %u / %u / %u / %u, impostors: %u, points: %u", bodyRenderer.GetLevelCount(0), bodyRenderer.GetLevelCount(1),
+			bodyRenderer.GetLevelCount(2), bodyRenderer.GetLevelCount(3), bodyRenderer.GetLevelCount(BodyRenderer::ImpostorLevel),
+			bodyRenderer.GetLevelCount(BodyRenderer::PointLevel));
 		ImGui::Checkbox("Show Trajectories", &SHOW_TRAJECTORIES);
 		ImGui::InputInt("Trajectory Size", &trajectorySize);
+		ImGui::SliderFloat("Trajectory Fade", &trajectoryLines.Fade, 0.0f, 1.0f);
 		ImGui::Separator();
 
-		ImGui::Text("Lighting Options");
-		ImGui::InputInt("Main Light Body ID", &lightBody, 1, 2);
-		if (ImGui::ColorEdit3("Ambient light color", glm::value_ptr(ambientLight)))
+		ImGui::Text("Gravity Options");
+		const char* solvers[] = { "Direct", "Barnes-Hut", "Direct (SIMD)", "Fast Multipole" };
+		int solver = static_cast<int>(simulation.GravityParams.Solver);
+		if (ImGui::Combo("Solver", &solver, solvers, IM_ARRAYSIZE(solvers)))
+			simulation.GravityParams.Solver = static_cast<GravitySolver>(solver);
+		ImGui::SliderFloat("Opening Angle (theta)", &simulation.GravityParams.Theta, 0.0f, 1.5f);
+		if (simulation.GravityParams.Solver == GravitySolver::Fmm)
+			ImGui::SliderInt("Expansion Order", &simulation.GravityParams.FmmOrder, 1, Fmm::MaxOrder);
+		ImGui::SliderFloat("Softening Length", &simulation.GravityParams.Softening, 0.0f, 1000.0f);
+		ImGui::Text("SIMD kernel: %s", GetSimdLevelName(simulation.GetGravity().GetKernel().GetLevel()));
+		int physicsThreads = static_cast<int>(ThreadPool::Get().GetThreadCount());
+		if (ImGui::InputInt("Physics Threads", &physicsThreads) && physicsThreads > 0)
+		{
+			// The predictor shares the pool and must not be inside it while it is rebuilt
+			trajectoryPredictor.Stop();
+			ThreadPool::Get().Resize(physicsThreads);
+		}
+		if (ImGui::Button("Measure Error"))
+			gravityError = simulation.GetGravity().MeasureError(particles, simulation.GravityParams);
+		if (gravityError >= 0)
+		{
+			ImGui::SameLine();
+			ImGui::Text("RMS error vs direct: %.2e", gravityError);
+		}
+		ImGui::Separator();
+
+		ImGui::Text("Checkpoint");
+		ImGui::InputText("File", checkpointPath, sizeof(checkpointPath));
+		if (ImGui::Button("Save"))
+		{
+			// The GPU backend's latest state has to reach the CPU first
+			if (simulation.Backend == &gpuPhysics && !replay.IsOpen())
+				gpuPhysics.Download(particles);
+			checkpointStatus = SaveCheckpoint(checkpointPath, simulation) ? "Saved" : "Save failed";
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Load"))
+		{
+			if (LoadCheckpoint(checkpointPath, simulation))
+			{
+				checkpointStatus = "Loaded " + std::to_string(particles.Size()) + " bodies";
+				selectedBody = -1;
+			}
+			else
+				checkpointStatus = "Load failed";
+		}
+		if (!checkpointStatus.empty())
+		{
+			ImGui::SameLine();
+			ImGui::Text("%s", checkpointStatus.c_str());
+		}
+		ImGui::Separator();
+
+		ImGui::Text("Recording");
+		ImGui::InputText("Recording File", recordingPath, sizeof(recordingPath));
+		if (ImGui::InputInt("Record Every (steps)", &recordEvery) && recordEvery < 1)
+			recordEvery = 1;
+		if (!recorder.IsRecording())
+		{
+			if (ImGui::Button("Record") && !replay.IsOpen())
+				recordingStatus = recorder.Start(recordingPath, recordEvery) ? "Recording" : "Failed to open file";
+		}
+		else
+		{
+			if (ImGui::Button("Stop Recording"))
+			{
+				recorder.Stop();
+				recordingStatus = "Wrote " + std::to_string(recorder.GetFrameCount()) + " frames";
+			}
+			ImGui::SameLine();
+			ImGui::Text("%llu frames", static_cast<unsigned long long>(recorder.GetFrameCount()));
+		}
+		ImGui::SameLine();
+		if (!replay.IsOpen())
+		{
+			if (ImGui::Button("Open Replay"))
+			{
+				recorder.Stop();
+				if (replay.Open(recordingPath))
+				{
+					replayFrame = 0;
+					replayShownFrame = -1;
+					replayPlaying = false;
+					selectedBody = -1;
+					recordingStatus = "Replaying " + std::to_string(replay.GetFrameCount()) + " frames";
+				}
+				else
+					recordingStatus = "Failed to open replay";
+			}
+		}
+		else if (ImGui::Button("Close Replay"))
 		{
-			shader.Activate();
-			glUniform3fv(glGetUniformLocation(shader.ProgramID, "uAmbientLight"), 1, glm::value_ptr(ambientLight));
+			// The simulation carries on from the frame on screen
+			replay.Close();
+			simulation.Invalidate();
+			recordingStatus.clear();
 		}
+		if (!recordingStatus.empty())
+			ImGui::Text("%s", recordingStatus.c_str());
+		if (replay.IsOpen())
+		{
+			ImGui::SliderInt("Frame", &replayFrame, 0, static_cast<int>(replay.GetFrameCount()) - 1);
+			ImGui::Text("Step %llu, time %.3f", static_cast<unsigned long long>(replay.GetFrameStep(replayFrame)), replay.GetFrameTime(replayFrame));
+			ImGui::Checkbox("Play", &replayPlaying);
+			ImGui::SameLine();
+			ImGui::SliderFloat("Frames per second", &replayRate, 1.0f, 240.0f);
+		}
+		ImGui::Separator();
+
+		ImGui::Text("Lighting Options");
+		ImGui::InputInt("Main Light Body ID", &lightBody, 1, 2);
+		ImGui::ColorEdit3("Ambient light color", glm::value_ptr(frameUniforms.AmbientLight));
 
-		if (selectedBody == -1 || selectedBody > bodies.size())
+		if (selectedBody == -1 || selectedBody >= (int)particles.Size())
 		{
 			ImGui::Separator();
 			if (ImGui::Button("New Body"))
-				bodies.push_back(new Body(camera.Position + camera.Orientation * 50.0f, glm::vec3(), 1e20, 1411));
+				particles.Add(camera.Position + Vec3(camera.Orientation * 50.0f), Vec3(0), 1e20, 1411);
 			ImGui::Separator();
 			ImGui::BeginChild("Scrolling");
-			for (int i = 0; i < bodies.size(); i++)
+			for (int i = 0; i < particles.Size(); i++)
 			{
 				std::string buttonLabel = "Body #" + std::to_string(i);
 				if (ImGui::Button(buttonLabel.c_str()))
@@ -425,15 +587,22 @@ int main()
 			ImGui::Text("Body Properties");
 			ImGui::Text("Body #%d", selectedBody);
 
-			ImGui::InputFloat3("Position", glm::value_ptr(bodies[selectedBody]->Position));
-			ImGui::InputFloat3("Velocity", glm::value_ptr(bodies[selectedBody]->Velocity));
-			if (ImGui::ColorEdit3("Color", glm::value_ptr(bodies[selectedBody]->Color)))
-				bodies[selectedBody]->RefreshMesh();
+			Body body(particles, selectedBody);
+			if (InputVec3("Position", body.Position()))
+				simulation.Invalidate();
+			if (InputVec3("Velocity", body.Velocity()))
+				simulation.Invalidate();
+			ImGui::ColorEdit3("Color", glm::value_ptr(body.Color()));
 
-			ImGui::InputDouble("Mass", &bodies[selectedBody]->Mass);
-			if (ImGui::InputFloat("Density", &bodies[selectedBody]->Density, 1, 10))
-				bodies[selectedBody]->RefreshMesh();
-			ImGui::Checkbox("Glows", &bodies[selectedBody]->Glows);
+			if (ImGui::InputDouble("Mass", &body.Mass())) {
+				body.RefreshRadius();
+				simulation.Invalidate();
+			}
+			if (ImGui::InputFloat("Density", &body.Density(), 1, 10))
+				body.RefreshRadius();
+			bool glows = body.Glows();
+			if (ImGui::Checkbox("Glows", &glows))
+				body.SetGlows(glows);
 
 			ImGui::Separator();
 			ImGui::SameLine();
@@ -446,17 +615,17 @@ int main()
 			if (ImGui::Button("Follow")) {
 				if (followingBody != selectedBody) {
 					followingBody = selectedBody;
-					bodyCameraOffset = bodies[selectedBody]->Position - camera.Position;
+					bodyCameraOffset = body.Position() - camera.Position;
 				}
 				else
 					followingBody = -1;
 			}
 
 			if (ImGui::Button("Look at"))
-				camera.LookAt(bodies[selectedBody]->Position);
+				camera.LookAt(body.Position());
 			ImGui::SameLine();
 			if (ImGui::Button("Go to"))
-				camera.Position = bodies[selectedBody]->Position + bodies[selectedBody]->Radius;
+				camera.Position = body.Position() + Real(body.Radius());
 			ImGui::SameLine();
 			if (ImGui::Button("Deselect"))
 				selectedBody = -1;
@@ -466,7 +635,7 @@ int main()
 			ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(1.0f, 0.1f, 0.1f, 1.0f));
 			if (ImGui::Button("Del"))
 			{
-                bodies.erase(bodies.begin() + selectedBody);
+				particles.Remove(selectedBody);
 				selectedBody = -1;
 			}
 			ImGui::PopStyleColor(3);
@@ -474,18 +643,29 @@ int main()
 
 		ImGui::End();
 
+		if (showProfiler)
+			profilerOverlay.Render(&showProfiler);
+
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		imguiProfile.reset();
 #pragma endregion
 
-		glfwSwapBuffers(window);
+		{
+			PROFILE_SCOPE("Swap");
+			glfwSwapBuffers(window);
+		}
+		StreamBuffer::EndFrame();
 		glfwPollEvents();
+		Profiler::Get().EndFrame();
 	}
 
-	for (Body* body : bodies)
-	{
-		body->Destroy();
-	}
+	trajectoryPredictor.Stop();
+	recorder.Stop();
+	bodyRenderer.Destroy();
+	grid.Destroy();
+	gpuPhysics.Destroy();
+	gpuProfiler.Destroy();
 	shader.Delete();
 
 	ImGui_ImplOpenGL3_Shutdown();
@@ -0,0 +1,222 @@
+#include "BodyRenderer.h"
+
+#include <cmath>
+
+#include "../utils/Math.h"
+
+BodyRenderer::BodyRenderer()
+{
+	// Finest first; each level halves the tessellation of the one before
+	int sectors = 64;
+	for (int level = 0; level < Levels; level++, sectors /= 2)
+	{
+		m_Meshes[level].FirstIndex = static_cast<GLuint>(m_Indices.size());
+		m_Meshes[level].BaseVertex = static_cast<GLint>(m_Vertices.size() / 6);
+		GenerateVertices(sectors / 2, sectors);
+		m_Meshes[level].IndexCount = static_cast<GLsizei>(m_Indices.size() - m_Meshes[level].FirstIndex);
+	}
+
+	m_VAO = VAO();
+	m_VAO.Bind();
+
+	m_VBO = new VBO(m_Vertices.data(), GLsizeiptr(m_Vertices.size() * sizeof(GLfloat)));
+	m_EBO = new EBO(m_Indices.data(), GLsizeiptr(m_Indices.size() * sizeof(GLuint)));
+
+	m_VAO.LinkAttrib(*m_VBO, 0, 3, GL_FLOAT, 6 * sizeof(float), (void*)0);
+	m_VAO.LinkAttrib(*m_VBO, 2, 3, GL_FLOAT, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+
+	// Instance attributes are linked every frame in UpdateInstances
+	m_Instances = new StreamBuffer(GLsizeiptr(1024 * InstanceFloats * sizeof(GLfloat)));
+
+	m_VAO.Unbind();
+	m_VBO->Unbind();
+	m_EBO->Unbind();
+}
+
+void BodyRenderer::Render(const ParticleSystem& particles, const std::vector<Vec3>& positions, Shader& shader, Shader& lightShader, Shader& impostorShader, Shader& pointShader, const Camera& camera, GLuint bodyBuffer)
+{
+	UpdateInstances(particles, positions, camera);
+	if (particles.Size() == 0)
+		return;
+
+	if (bodyBuffer)
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, bodyBuffer, 0, GLsizeiptr(particles.Size() * sizeof(glm::vec4)));
+
+	m_VAO.Bind();
+	RenderPass(shader, m_Ranges[0], bodyBuffer != 0);
+	RenderPass(lightShader, m_Ranges[1], bodyBuffer != 0);
+	RenderImpostors(impostorShader, m_Ranges[0][ImpostorLevel], false, bodyBuffer != 0);
+	RenderImpostors(impostorShader, m_Ranges[1][ImpostorLevel], true, bodyBuffer != 0);
+	RenderPoints(pointShader, m_Ranges[0][PointLevel], false, bodyBuffer != 0);
+	RenderPoints(pointShader, m_Ranges[1][PointLevel], true, bodyBuffer != 0);
+	m_VAO.Unbind();
+}
+
+GLuint BodyRenderer::GetLevelCount(int level) const
+{
+	if (level < 0 || level > PointLevel)
+		return 0;
+	return m_Ranges[0][level].Count + m_Ranges[1][level].Count;
+}
+
+int BodyRenderer::ChooseLevel(const glm::vec3& position, float radius, float pixelsPerUnit) const
+{
+	float distance = glm::length(position);
+	if (distance <= radius)
+		return 0;
+	float pixels = DetailScale * radius * pixelsPerUnit / distance;
+	if (pixels < LevelPixels[Levels - 1])
+		return PointLevel;
+	if (UseImpostors && pixels < ImpostorPixels)
+		return ImpostorLevel;
+	for (int level = 0; level < Levels; level++)
+		if (pixels >= LevelPixels[level])
+			return level;
+	return Levels - 1;
+}
+
+void BodyRenderer::UpdateInstances(const ParticleSystem& particles, const std::vector<Vec3>& positions, const Camera& camera)
+{
+	size_t count = particles.Size();
+	for (auto& ranges : m_Ranges)
+		for (Range& range : ranges)
+			range = Range();
+	if (count == 0)
+		return;
+
+	// Screen pixels covered by one unit of length at distance one
+	m_PixelsPerUnit = camera.height / (2.0f * std::tan(glm::radians(camera.FOVdeg) / 2.0f));
+
+	// Counting sort by (glow, level), so each pass draws contiguous ranges
+	const int slotCount = 2 * (PointLevel + 1);
+	GLuint counts[slotCount] = {};
+	m_Slots.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		int level = ChooseLevel(camera.GetRelative(positions[i]), particles.Radii[i], m_PixelsPerUnit);
+		m_Slots[i] = static_cast<uint8_t>((particles.Glows[i] ? PointLevel + 1 : 0) + level);
+		counts[m_Slots[i]]++;
+	}
+	GLuint next[slotCount];
+	GLuint first = 0;
+	for (int slot = 0; slot < slotCount; slot++)
+	{
+		Range& range = m_Ranges[slot / (PointLevel + 1)][slot % (PointLevel + 1)];
+		range.First = first;
+		range.Count = counts[slot];
+		next[slot] = first;
+		first += counts[slot];
+	}
+
+	// Written straight into mapped memory
+	GLfloat* instances = static_cast<GLfloat*>(m_Instances->Map(GLsizeiptr(count * InstanceFloats * sizeof(GLfloat))));
+	for (size_t i = 0; i < count; i++)
+	{
+		GLfloat* instance = instances + size_t(next[m_Slots[i]]++) * InstanceFloats;
+		glm::vec3 position = camera.GetRelative(positions[i]);
+		instance[0] = position.x;
+		instance[1] = position.y;
+		instance[2] = position.z;
+		instance[3] = particles.Radii[i];
+		instance[4] = particles.Colors[i].r;
+		instance[5] = particles.Colors[i].g;
+		instance[6] = particles.Colors[i].b;
+		instance[7] = float(i);
+	}
+
+	GLintptr offset = m_Instances->GetOffset();
+	m_VAO.Bind();
+	m_VAO.LinkAttrib(*m_Instances, 3, 4, GL_FLOAT, InstanceFloats * sizeof(float), offset, 1);
+	m_VAO.LinkAttrib(*m_Instances, 1, 3, GL_FLOAT, InstanceFloats * sizeof(float), offset + 4 * sizeof(float), 1);
+	m_VAO.LinkAttrib(*m_Instances, 4, 1, GL_FLOAT, InstanceFloats * sizeof(float), offset + 7 * sizeof(float), 1);
+	m_VAO.Unbind();
+}
+
+void BodyRenderer::RenderPass(Shader& shader, const Range* ranges, bool bodyBuffer)
+{
+	bool active = false;
+	for (int level = 0; level < Levels; level++)
+	{
+		const Range& range = ranges[level];
+		if (range.Count == 0)
+			continue;
+		if (!active)
+		{
+			shader.Activate();
+			shader.SetInt("uBodyBuffer", bodyBuffer);
+			active = true;
+		}
+		const Mesh& mesh = m_Meshes[level];
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh.IndexCount, GL_UNSIGNED_INT, (void*)(mesh.FirstIndex * sizeof(GLuint)),
+			GLsizei(range.Count), mesh.BaseVertex, range.First);
+	}
+}
+
+void BodyRenderer::RenderImpostors(Shader& shader, const Range& range, bool glow, bool bodyBuffer)
+{
+	if (range.Count == 0)
+		return;
+
+	shader.Activate();
+	shader.SetInt("uBodyBuffer", bodyBuffer);
+	shader.SetInt("uGlow", glow);
+	// Four vertices per body; the corners come from gl_VertexID
+	glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, GLsizei(range.Count), range.First);
+}
+
+void BodyRenderer::RenderPoints(Shader& shader, const Range& range, bool glow, bool bodyBuffer)
+{
+	if (range.Count == 0)
+		return;
+
+	shader.Activate();
+	shader.SetInt("uBodyBuffer", bodyBuffer);
+	shader.SetInt("uGlow", glow);
+	shader.SetFloat("uPixelsPerUnit", m_PixelsPerUnit);
+	// One vertex per body; the point shader only reads instance attributes
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glDrawArraysInstancedBaseInstance(GL_POINTS, 0, 1, GLsizei(range.Count), range.First);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+void BodyRenderer::GenerateVertices(int stacks, int sectors)
+{
+	// Indexed UV sphere: rings share vertices, the seam and poles are duplicated
+	// so every vertex keeps a single position on the (stacks+1) x (sectors+1) grid
+	GLuint columns = static_cast<GLuint>(sectors + 1);
+	for (int i = 0; i <= stacks; ++i) {
+		float theta = float(i) / stacks * glm::pi<float>();
+		for (int j = 0; j <= sectors; ++j) {
+			float phi = float(j) / sectors * 2 * glm::pi<float>();
+			glm::vec3 v = sphericalToCartesian(1.0f, theta, phi);
+			// On a unit sphere the position doubles as the normal
+			m_Vertices.insert(m_Vertices.end(), { v.x, v.y, v.z, v.x, v.y, v.z });
+		}
+	}
+
+	// Indices are relative to the mesh's first vertex (drawn with a base vertex)
+	for (GLuint i = 0; i < GLuint(stacks); ++i) {
+		for (GLuint j = 0; j < GLuint(sectors); ++j) {
+			GLuint v1 = i * columns + j;
+			GLuint v2 = v1 + 1;
+			GLuint v3 = v1 + columns;
+			GLuint v4 = v3 + 1;
+			// Triangles touching a pole collapse on one side; leave those out
+			if (i != 0)
+				m_Indices.insert(m_Indices.end(), { v1, v2, v3 });
+			if (i != GLuint(stacks) - 1)
+				m_Indices.insert(m_Indices.end(), { v3, v2, v4 });
+		}
+	}
+}
+
+void BodyRenderer::Destroy()
+{
+	m_VAO.Delete();
+	m_VBO->Delete();
+	m_EBO->Delete();
+	m_Instances->Delete();
+	delete m_VBO;
+	delete m_EBO;
+	delete m_Instances;
+}
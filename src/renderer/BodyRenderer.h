@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl/VAO.h"
+#include "gl/VBO.h"
+#include "gl/EBO.h"
+#include "gl/StreamBuffer.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "../engine/ParticleSystem.h"
+
+// Draws every body of a ParticleSystem with shared unit sphere meshes at a few
+// levels of detail, picked per body from its radius on screen. Small bodies are
+// ray traced on camera-facing quads (impostors) and bodies too small for any
+// surface become point sprites. Instances are grouped by level, so each level
+// costs one instanced draw call for lit bodies and one for glowing bodies.
+class BodyRenderer
+{
+public:
+	BodyRenderer();
+
+	// bodyBuffer: optional storage buffer of vec4 positions (e.g. GpuNBody) used instead of positions.
+	// Levels are still chosen from positions, so they should be roughly current.
+	void Render(const ParticleSystem& particles, const std::vector<Vec3>& positions, Shader& shader, Shader& lightShader, Shader& impostorShader, Shader& pointShader, const Camera& camera, GLuint bodyBuffer=0);
+	void Destroy();
+
+	// Number of bodies drawn at a level in the last frame, up to PointLevel
+	GLuint GetLevelCount(int level) const;
+
+	static const int Levels = 4; // sphere meshes
+	static const int ImpostorLevel = Levels;
+	static const int PointLevel = Levels + 1;
+	// Smallest projected radius in pixels drawn with each mesh, finest first;
+	// anything smaller is a point sprite
+	static constexpr float LevelPixels[Levels] = { 24.0f, 8.0f, 3.0f, 1.5f };
+
+	float DetailScale = 1.0f; // multiplies projected radii before choosing a level
+	bool UseImpostors = true;
+	float ImpostorPixels = 8.0f; // bodies with a smaller projected radius are impostors instead of meshes
+private:
+	struct Mesh
+	{
+		GLuint FirstIndex;
+		GLsizei IndexCount;
+		GLint BaseVertex;
+	};
+	struct Range
+	{
+		GLuint First = 0;
+		GLuint Count = 0;
+	};
+
+	int ChooseLevel(const glm::vec3& position, float radius, float pixelsPerUnit) const;
+	void UpdateInstances(const ParticleSystem& particles, const std::vector<Vec3>& positions, const Camera& camera);
+	void RenderPass(Shader& shader, const Range* ranges, bool bodyBuffer);
+	void RenderImpostors(Shader& shader, const Range& range, bool glow, bool bodyBuffer);
+	void RenderPoints(Shader& shader, const Range& range, bool glow, bool bodyBuffer);
+	void GenerateVertices(int stacks, int sectors);
+
+	// Per-instance layout: position relative to the camera (3), radius (1), color (3), body index (1)
+	static const int InstanceFloats = 8;
+
+	VAO m_VAO;
+	VBO* m_VBO;
+	EBO* m_EBO;
+	StreamBuffer* m_Instances;
+
+	std::vector<GLfloat> m_Vertices;
+	std::vector<GLuint> m_Indices;
+	Mesh m_Meshes[Levels];
+	// Instance ranges of lit [0] and glowing [1] bodies per level, then impostors and points
+	Range m_Ranges[2][PointLevel + 1];
+	std::vector<uint8_t> m_Slots;
+	float m_PixelsPerUnit = 0.0f;
+};
@@ -1,6 +1,6 @@
 #include "Camera.h"
 
-Camera::Camera(int width, int height, glm::vec3 pos, float FOV, float np, float fp)
+Camera::Camera(int width, int height, const Vec3& pos, float FOV, float np, float fp)
 	: Position(pos), width(width), height(height), FOVdeg(FOV), nearPlane(np), farPlane(fp)
 {
 }
@@ -13,43 +13,31 @@ void Camera::UpdateMatrix()
 	CameraMatrix = projection * view;
 }
 
-void Camera::Update(Shader& shader)
-{
-	glUniformMatrix4fv(glGetUniformLocation(shader.ProgramID, "camMatrix"), 1, GL_FALSE, glm::value_ptr(CameraMatrix));
-	glUniform3fv(glGetUniformLocation(shader.ProgramID, "viewPos"), 1, glm::value_ptr(Position));
-}
-
-void Camera::Update(Shader& shader, const char* uniform, glm::mat4 matrix)
-{
-	glUniformMatrix4fv(glGetUniformLocation(shader.ProgramID, uniform), 1, GL_FALSE, glm::value_ptr(matrix));
-	glUniform3fv(glGetUniformLocation(shader.ProgramID, "viewPos"), 1, glm::value_ptr(Position));
-}
-
 void Camera::HandleInput(GLFWwindow* window, float dt)
 {
 	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		Position += speed * dt * Orientation;
+		Position += Vec3(speed * dt * Orientation);
 	}
 	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		Position += speed * dt * -Orientation;
+		Position += Vec3(speed * dt * -Orientation);
 	}
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		Position += speed * dt * glm::normalize(glm::cross(Orientation, Up));
+		Position += Vec3(speed * dt * glm::normalize(glm::cross(Orientation, Up)));
 	}
 	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		Position += speed * dt * -glm::normalize(glm::cross(Orientation, Up));
+		Position += Vec3(speed * dt * -glm::normalize(glm::cross(Orientation, Up)));
 	}
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 	{
-		Position += speed * dt * Up;
+		Position += Vec3(speed * dt * Up);
 	}
 	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
 	{
-		Position += speed * dt * -Up;
+		Position += Vec3(speed * dt * -Up);
 	}
 	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
 	{
@@ -97,14 +85,14 @@ void Camera::HandleScroll(GLFWwindow* window, double xoffset, double yoffset)
 	FOVdeg = std::max(1.0f, std::min(80.0f, FOVdeg - (float)yoffset));
 }
 
-void Camera::LookAt(glm::vec3 target)
+void Camera::LookAt(const Vec3& target)
 {
-    Orientation = glm::normalize(target - Position);
+    Orientation = glm::normalize(GetRelative(target));
 }
 
 glm::mat4 Camera::GetViewMatrix()
 {
-	return glm::lookAt(Position, Position + Orientation, Up);
+	return glm::lookAt(glm::vec3(0.0f), Orientation, Up);
 }
 
 glm::mat4 Camera::GetProjectionMatrix()
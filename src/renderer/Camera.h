@@ -8,14 +8,17 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/gtx/vector_angle.hpp>
-#include "Shader.h"
+#include "../engine/Precision.h"
 
+// Everything is drawn relative to the camera: the view matrix only rotates, and
+// world positions (in Real) become float offsets through GetRelative, so the
+// precision on screen does not depend on how far the camera is from the origin.
 class Camera
 {
 public:
-	Camera(int width, int height, glm::vec3 pos, float FOV, float np, float fp);
+	Camera(int width, int height, const Vec3& pos, float FOV, float np, float fp);
 
-	glm::vec3 Position;
+	Vec3 Position;
 	glm::vec3 Orientation = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	glm::mat4 CameraMatrix = glm::mat4(1.0f);
@@ -24,12 +27,11 @@ public:
 	float FOVdeg, nearPlane, farPlane;
 
 	void UpdateMatrix();
-	void Update(Shader& shader);
-	void Update(Shader& shader, const char* uniform, glm::mat4 matrix);
 	void HandleInput(GLFWwindow* window, float dt);
 	void HandleScroll(GLFWwindow* window, double xoffset, double yoffset);
 
-	void LookAt(glm::vec3 target);
+	void LookAt(const Vec3& target);
+	glm::vec3 GetRelative(const Vec3& position) const { return glm::vec3(position - Position); }
 
 	glm::mat4 GetViewMatrix();
 	glm::mat4 GetProjectionMatrix();
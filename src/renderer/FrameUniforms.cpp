@@ -0,0 +1,25 @@
+#include "FrameUniforms.h"
+
+FrameUniforms::FrameUniforms()
+{
+	m_Buffer = new StreamBuffer(GLsizeiptr(sizeof(Block)));
+}
+
+FrameUniforms::~FrameUniforms()
+{
+	m_Buffer->Delete();
+	delete m_Buffer;
+}
+
+void FrameUniforms::Update(const Camera& camera)
+{
+	Block* block = static_cast<Block*>(m_Buffer->Map(GLsizeiptr(sizeof(Block))));
+	block->CameraMatrix = camera.CameraMatrix;
+	// The scene is drawn relative to the camera, which makes it the origin
+	block->ViewPosition = glm::vec4(0.0f);
+	block->CameraOrigin = glm::vec4(glm::vec3(camera.Position), 0.0f);
+	block->LightPosition = glm::vec4(camera.GetRelative(LightPosition), 0.0f);
+	block->LightColor = glm::vec4(LightColor, 0.0f);
+	block->AmbientLight = glm::vec4(AmbientLight, 0.0f);
+	glBindBufferRange(GL_UNIFORM_BUFFER, Binding, m_Buffer->ID, m_Buffer->GetOffset(), GLsizeiptr(sizeof(Block)));
+}
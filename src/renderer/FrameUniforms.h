@@ -0,0 +1,39 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl/StreamBuffer.h"
+#include "Camera.h"
+#include "../engine/Precision.h"
+
+// The Frame uniform block shared by every shader: camera matrix, view position
+// and lighting. It is written once per frame and bound to uniform binding
+// Binding, so programs need no per-draw camera or light uniforms.
+class FrameUniforms
+{
+public:
+	FrameUniforms();
+	~FrameUniforms();
+
+	// Call after Camera::UpdateMatrix and before the frame's first draw
+	void Update(const Camera& camera);
+
+	Vec3 LightPosition = Vec3(0); // world space
+	glm::vec3 LightColor = glm::vec3(1.0f);
+	glm::vec3 AmbientLight = glm::vec3(0.0f);
+
+	static const GLuint Binding = 0;
+private:
+	// std140 layout of Frame; every vec3 takes the 16 bytes of a vec4
+	struct Block
+	{
+		glm::mat4 CameraMatrix;
+		glm::vec4 ViewPosition;
+		glm::vec4 CameraOrigin;
+		glm::vec4 LightPosition;
+		glm::vec4 LightColor;
+		glm::vec4 AmbientLight;
+	};
+
+	StreamBuffer* m_Buffer;
+};
@@ -0,0 +1,96 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+
+GpuProfiler::~GpuProfiler()
+{
+	Destroy();
+}
+
+void GpuProfiler::BeginFrame()
+{
+	m_Current = nullptr;
+	m_Open = false;
+	Profiler& profiler = Profiler::Get();
+	if (!profiler.IsEnabled())
+		return;
+
+	for (Frame& frame : m_Frames)
+		if (frame.Pending)
+			Resolve(frame, false);
+
+	// The slot about to be reused is FramesInFlight frames old, waiting on it rarely stalls
+	Frame& frame = m_Frames[profiler.GetFrameIndex() % FramesInFlight];
+	if (frame.Pending)
+		Resolve(frame, true);
+	if (frame.Ids.empty())
+	{
+		frame.Ids.resize(size_t(MaxQueries));
+		glGenQueries(MaxQueries, frame.Ids.data());
+	}
+	frame.Index = profiler.GetFrameIndex();
+	frame.Queries.clear();
+	frame.Pending = true;
+	m_Current = &frame;
+}
+
+int GpuProfiler::Begin(const char* name)
+{
+	if (!m_Current || m_Open || m_Current->Queries.size() >= MaxQueries || m_Current->Index != Profiler::Get().GetFrameIndex())
+		return -1;
+	int query = static_cast<int>(m_Current->Queries.size());
+	m_Current->Queries.push_back({ name, Profiler::Get().GetFrameTime() });
+	glBeginQuery(GL_TIME_ELAPSED, m_Current->Ids[query]);
+	m_Open = true;
+	return query;
+}
+
+void GpuProfiler::End(int query)
+{
+	if (!m_Open)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	m_Open = false;
+}
+
+bool GpuProfiler::Resolve(Frame& frame, bool wait)
+{
+	if (!frame.Queries.empty() && !wait)
+	{
+		// Queries finish in order, so the last one being ready means all are
+		GLuint available = 0;
+		glGetQueryObjectuiv(frame.Ids[frame.Queries.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+	}
+
+	// Only durations are known; stages are laid out back to back on the GPU track,
+	// never starting before the CPU submitted them
+	Profiler& profiler = Profiler::Get();
+	double gpuEnd = 0;
+	for (size_t i = 0; i < frame.Queries.size(); i++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(frame.Ids[i], GL_QUERY_RESULT, &elapsed);
+		double duration = elapsed / 1e6;
+		double start = std::max(frame.Queries[i].CpuStart, gpuEnd);
+		profiler.AddGpuEvent(frame.Index, frame.Queries[i].Name, start, duration);
+		gpuEnd = start + duration;
+	}
+	profiler.ResolveGpuFrame(frame.Index);
+	frame.Pending = false;
+	return true;
+}
+
+void GpuProfiler::Destroy()
+{
+	for (Frame& frame : m_Frames)
+	{
+		if (!frame.Ids.empty())
+			glDeleteQueries(static_cast<GLsizei>(frame.Ids.size()), frame.Ids.data());
+		frame.Ids.clear();
+		frame.Queries.clear();
+		frame.Pending = false;
+	}
+	m_Current = nullptr;
+}
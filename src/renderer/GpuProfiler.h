@@ -0,0 +1,66 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+#include "../utils/Profiler.h"
+
+// Times GPU work of the frame stages with GL_TIME_ELAPSED queries and feeds the
+// results into Profiler once they are available, a few frames later. Elapsed time
+// queries cannot nest, so a stage opened inside another one is timed on the CPU only.
+// Nothing is issued while the profiler is disabled.
+class GpuProfiler
+{
+public:
+	~GpuProfiler();
+
+	// Call after Profiler::BeginFrame(); collects finished queries of earlier frames
+	void BeginFrame();
+	// Returns a query handle for End, or -1 if nothing is timed
+	int Begin(const char* name);
+	void End(int query);
+	void Destroy();
+
+	static const int FramesInFlight = 4;
+	static const int MaxQueries = 32; // per frame
+private:
+	struct Query
+	{
+		const char* Name;
+		double CpuStart; // ms into the frame when the work was submitted
+	};
+	struct Frame
+	{
+		uint64_t Index = 0;
+		bool Pending = false;
+		std::vector<GLuint> Ids;
+		std::vector<Query> Queries;
+	};
+
+	// Hands the results to Profiler; wait blocks until the GPU finished them
+	bool Resolve(Frame& frame, bool wait);
+
+	Frame m_Frames[FramesInFlight];
+	Frame* m_Current = nullptr;
+	bool m_Open = false;
+};
+
+// Times the enclosing block on the CPU and, if no other GPU stage is open, on the GPU
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& profiler, const char* name)
+		: m_Cpu(name), m_Profiler(profiler), m_Query(Profiler::Get().IsEnabled() ? profiler.Begin(name) : -1) {}
+	~GpuProfileScope()
+	{
+		if (m_Query >= 0)
+			m_Profiler.End(m_Query);
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+private:
+	ProfileScope m_Cpu;
+	GpuProfiler& m_Profiler;
+	int m_Query;
+};
@@ -1,38 +1,64 @@
 #include "LineRenderer.h"
 
-LineRenderer::LineRenderer(std::vector<GLfloat> verts)
-	: m_Vertices(verts)
+#include <cstring>
+
+LineRenderer::LineRenderer()
 {
 	m_VAO = VAO();
-	m_VAO.Bind();
-
-	m_VBO = new VBO(m_Vertices.data(), GLsizeiptr(m_Vertices.size() * sizeof(GLfloat)), GL_DYNAMIC_DRAW);
-
-	m_VAO.LinkAttrib(*m_VBO, 0, 3, GL_FLOAT, 6 * sizeof(float), (void*)0);
-	m_VAO.LinkAttrib(*m_VBO, 1, 3, GL_FLOAT, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-
-	m_VAO.Unbind();
-	m_VBO->Unbind();
+	m_Buffer = new StreamBuffer(GLsizeiptr(4096 * VertexFloats * sizeof(GLfloat)));
 }
 
 LineRenderer::~LineRenderer()
 {
 	m_VAO.Delete();
-	m_VBO->Delete();
+	m_Buffer->Delete();
+	delete m_Buffer;
 }
 
-void LineRenderer::Update(std::vector<GLfloat> verts)
+void LineRenderer::Update(const std::vector<GLfloat>& verts, const std::vector<GLsizei>& counts)
 {
-	m_Vertices = verts;
-	m_VBO->Bind();
-	glBufferData(GL_ARRAY_BUFFER, m_Vertices.size() * sizeof(GLfloat), m_Vertices.data(), GL_DYNAMIC_DRAW);
+	m_Firsts.clear();
+	m_Counts.clear();
+	if (verts.empty())
+		return;
+
+	GLint first = 0;
+	for (GLsizei count : counts)
+	{
+		// A strip needs two points; skipping here keeps the vertex offsets intact
+		if (count >= 2)
+		{
+			m_Firsts.push_back(first);
+			m_Counts.push_back(count);
+		}
+		first += count;
+	}
+
+	GLsizeiptr size = GLsizeiptr(verts.size() * sizeof(GLfloat));
+	memcpy(m_Buffer->Map(size), verts.data(), size);
+
+	GLintptr offset = m_Buffer->GetOffset();
+	GLsizei stride = VertexFloats * sizeof(float);
+	m_VAO.Bind();
+	m_VAO.LinkAttrib(*m_Buffer, 0, 3, GL_FLOAT, stride, offset);
+	m_VAO.LinkAttrib(*m_Buffer, 1, 3, GL_FLOAT, stride, offset + 3 * sizeof(float));
+	m_VAO.LinkAttrib(*m_Buffer, 2, 1, GL_FLOAT, stride, offset + 6 * sizeof(float));
+	m_VAO.Unbind();
 }
 
-void LineRenderer::Render(Shader& shader, Camera& camera)
+void LineRenderer::Render(Shader& shader)
 {
+	if (m_Counts.empty())
+		return;
 	shader.Activate();
-	camera.Update(shader);
+	shader.SetFloat("uFade", Fade);
 	m_VAO.Bind();
-	glLineWidth(4.0f);
-	glDrawArrays(GL_LINE_STRIP, 0, m_Vertices.size() / 6);
+	glLineWidth(Width);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glMultiDrawArrays(GL_LINE_STRIP, m_Firsts.data(), m_Counts.data(), GLsizei(m_Counts.size()));
+	glBlendFunc(GL_ONE, GL_ZERO);
+
+	m_VAO.Unbind();
 }
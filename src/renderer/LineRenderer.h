@@ -1,20 +1,31 @@
 #pragma once
+#include <vector>
 
 #include "gl/VAO.h"
+#include "gl/StreamBuffer.h"
 #include "Shader.h"
-#include "Camera.h"
 
+// Draws any number of polylines from one buffer with a single glMultiDrawArrays.
+// Vertices are 7 floats: position (3), color (3) and age (1), where age runs from
+// 0 at the start of a line to 1 at its end and fades the line out (line-frag.glsl).
 class LineRenderer
 {
 public:
-	LineRenderer(std::vector<GLfloat> verts);
+	LineRenderer();
 	~LineRenderer();
 
-	void Update(std::vector<GLfloat> verts);
-	void Render(Shader& shader, Camera& camera);
+	// verts holds the lines back to back, counts the number of vertices in each
+	void Update(const std::vector<GLfloat>& verts, const std::vector<GLsizei>& counts);
+	void Render(Shader& shader);
+
+	static const int VertexFloats = 7;
+
+	float Fade = 0.8f; // alpha lost by the oldest vertex, 0 disables fading
+	float Width = 4.0f;
 private:
 	VAO m_VAO;
-	VBO* m_VBO;
+	StreamBuffer* m_Buffer;
 
-	std::vector<GLfloat> m_Vertices;
-};
\ No newline at end of file
+	std::vector<GLint> m_Firsts;
+	std::vector<GLsizei> m_Counts;
+};
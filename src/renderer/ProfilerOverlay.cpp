@@ -0,0 +1,153 @@
+#include "ProfilerOverlay.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <imgui.h>
+
+// GPU times of a frame arrive at most this many frames after it
+static const int GpuLatency = 8;
+
+static ImU32 GetStageColor(const char* name, bool gpu)
+{
+	// Stable color per stage name
+	uint32_t hash = 2166136261u;
+	for (const char* c = name; *c; c++)
+		hash = (hash ^ uint8_t(*c)) * 16777619u;
+	int r = 80 + hash % 120, g = 80 + (hash >> 8) % 120, b = 80 + (hash >> 16) % 120;
+	return gpu ? IM_COL32(r / 2, g, b, 255) : IM_COL32(r, g, b / 2, 255);
+}
+
+void ProfilerOverlay::Render(bool* open)
+{
+	if (!ImGui::Begin("Profiler", open))
+	{
+		ImGui::End();
+		return;
+	}
+
+	Profiler& profiler = Profiler::Get();
+	bool recording = profiler.IsEnabled();
+	if (ImGui::Checkbox("Record", &recording))
+		profiler.SetEnabled(recording);
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(200);
+	ImGui::InputText("##ExportPath", ExportPath, sizeof(ExportPath));
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace"))
+		m_Status = profiler.ExportChromeTrace(ExportPath) ? "Exported" : "Export failed";
+	if (!m_Status.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", m_Status.c_str());
+	}
+
+	size_t count = profiler.GetFrameCount();
+	if (count == 0)
+	{
+		ImGui::Text("No frames recorded");
+		ImGui::End();
+		return;
+	}
+
+	m_FrameTimes.resize(count);
+	float slowest = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		m_FrameTimes[i] = static_cast<float>(profiler.GetFrame(i).Duration);
+		slowest = std::max(slowest, m_FrameTimes[i]);
+	}
+	ImGui::PlotHistogram("##FrameTimes", m_FrameTimes.data(), static_cast<int>(count), 0, "Frame time (ms)", 0.0f, slowest, ImVec2(-1, 60));
+
+	// Follow the newest frame whose GPU times arrived
+	int newest = static_cast<int>(count) - 1;
+	int shown = m_Selected;
+	if (shown < 0 || shown > newest)
+	{
+		shown = newest;
+		for (int i = newest; i >= 0 && i > newest - GpuLatency; i--)
+		{
+			if (profiler.GetFrame(i).GpuResolved)
+			{
+				shown = i;
+				break;
+			}
+		}
+	}
+	bool follow = m_Selected < 0;
+	if (ImGui::Checkbox("Follow", &follow))
+		m_Selected = follow ? -1 : shown;
+	ImGui::SameLine();
+	if (ImGui::SliderInt("Frame", &shown, 0, newest))
+		m_Selected = shown;
+
+	const ProfileFrame& frame = profiler.GetFrame(shown);
+	ImGui::Text("Frame %llu: %.3f ms", static_cast<unsigned long long>(frame.Index), frame.Duration);
+	RenderTimeline(frame);
+
+	// Mean time of every stage over the history
+	m_Totals.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		for (const ProfileEvent& event : profiler.GetFrame(i).Events)
+		{
+			auto it = std::find_if(m_Totals.begin(), m_Totals.end(), [&](const StageTotal& total)
+			{
+				return total.Gpu == event.Gpu && std::strcmp(total.Name, event.Name) == 0;
+			});
+			if (it == m_Totals.end())
+				m_Totals.push_back({ event.Name, event.Gpu, event.Duration, 1 });
+			else
+			{
+				it->Total += event.Duration;
+				it->Count++;
+			}
+		}
+	}
+	ImGui::Separator();
+	ImGui::Text("Average over %zu frames", count);
+	for (const StageTotal& total : m_Totals)
+		ImGui::Text("%s %-24s %8.3f ms", total.Gpu ? "GPU" : "CPU", total.Name, total.Total / total.Count);
+
+	ImGui::End();
+}
+
+void ProfilerOverlay::RenderTimeline(const ProfileFrame& frame)
+{
+	int cpuRows = 1;
+	for (const ProfileEvent& event : frame.Events)
+		if (!event.Gpu)
+			cpuRows = std::max(cpuRows, event.Depth + 1);
+
+	float rowHeight = ImGui::GetTextLineHeight() + 4;
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+	float height = rowHeight * (cpuRows + 1);
+	ImGui::InvisibleButton("##Timeline", ImVec2(width, height));
+	bool hovered = ImGui::IsItemHovered();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(30, 30, 30, 255));
+	drawList->PushClipRect(origin, ImVec2(origin.x + width, origin.y + height), true);
+
+	// GPU work may end after the CPU side of the frame did
+	double span = frame.Duration;
+	for (const ProfileEvent& event : frame.Events)
+		span = std::max(span, event.Start + event.Duration);
+	float scale = span > 0 ? static_cast<float>(width / span) : 0.0f;
+
+	for (const ProfileEvent& event : frame.Events)
+	{
+		int row = event.Gpu ? cpuRows : event.Depth;
+		ImVec2 min(origin.x + static_cast<float>(event.Start) * scale, origin.y + row * rowHeight);
+		ImVec2 max(std::max(min.x + 1, min.x + static_cast<float>(event.Duration) * scale), min.y + rowHeight - 1);
+		drawList->AddRectFilled(min, max, GetStageColor(event.Name, event.Gpu));
+		if (max.x - min.x > ImGui::CalcTextSize(event.Name).x + 4)
+			drawList->AddText(ImVec2(min.x + 2, min.y + 2), IM_COL32(255, 255, 255, 255), event.Name);
+		if (hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+			ImGui::SetTooltip("%s %s\nstart %.3f ms\nduration %.3f ms", event.Gpu ? "GPU" : "CPU", event.Name, event.Start, event.Duration);
+	}
+	drawList->AddText(ImVec2(origin.x + 2, origin.y + cpuRows * rowHeight + 2), IM_COL32(160, 160, 160, 255), frame.GpuResolved ? "" : "GPU pending");
+	drawList->PopClipRect();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "../utils/Profiler.h"
+
+// ImGui window showing the Profiler history: frame times, a timeline of the stages
+// of one frame (CPU scopes by nesting depth, GPU stages on their own row) and
+// per-stage averages. Turning recording off keeps the history for inspection.
+class ProfilerOverlay
+{
+public:
+	void Render(bool* open);
+
+	char ExportPath[256] = "profile.json";
+private:
+	struct StageTotal
+	{
+		const char* Name;
+		bool Gpu;
+		double Total;
+		size_t Count;
+	};
+
+	void RenderTimeline(const ProfileFrame& frame);
+
+	int m_Selected = -1; // history index, -1 follows the newest complete frame
+	std::vector<float> m_FrameTimes;
+	std::vector<StageTotal> m_Totals;
+	std::string m_Status;
+};
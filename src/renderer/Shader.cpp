@@ -1,5 +1,10 @@
 #include "Shader.h"
 
+#include <cstring>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
 Shader::Shader(const char* vertexFile, const char* fragmentFile)
 {
 	std::string vertexShaderSource = get_file_contents(vertexFile);
@@ -16,16 +21,36 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile)
 	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
 	glCompileShader(fragmentShader);
-	compileError(vertexShader, "FRAGMENT");
+	compileError(fragmentShader, "FRAGMENT");
 
 	ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, vertexShader);
 	glAttachShader(ProgramID, fragmentShader);
 	glLinkProgram(ProgramID);
-	compileError(vertexShader, "PROGRAM");
+	compileError(ProgramID, "PROGRAM");
+	Reflect();
 
 	glDeleteShader(vertexShader);
-	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+}
+
+Shader::Shader(const char* computeFile)
+{
+	std::string computeShaderSource = get_file_contents(computeFile);
+	const char* computeSource = computeShaderSource.c_str();
+
+	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(computeShader, 1, &computeSource, nullptr);
+	glCompileShader(computeShader);
+	compileError(computeShader, "COMPUTE");
+
+	ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, computeShader);
+	glLinkProgram(ProgramID);
+	compileError(ProgramID, "PROGRAM");
+	Reflect();
+
+	glDeleteShader(computeShader);
 }
 
 void Shader::Activate()
@@ -36,13 +61,66 @@ void Shader::Activate()
 void Shader::Delete()
 {
 	glDeleteProgram(ProgramID);
+	m_Uniforms.clear();
+}
+
+void Shader::Reflect()
+{
+	m_Uniforms.clear();
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(ProgramID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer(size_t(maxLength) + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(ProgramID, GLuint(i), GLsizei(buffer.size()), &length, &size, &type, buffer.data());
+		// Members of uniform blocks have no location; they are set through the block's buffer
+		GLint location = glGetUniformLocation(ProgramID, buffer.data());
+		if (location < 0)
+			continue;
+		std::string name(buffer.data(), size_t(length));
+		// Arrays are reported as name[0]
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+			name.resize(name.size() - 3);
+		m_Uniforms[name] = location;
+	}
+}
+
+GLint Shader::GetUniformLocation(const std::string& name) const
+{
+	auto it = m_Uniforms.find(name);
+	return it != m_Uniforms.end() ? it->second : -1;
+}
+
+void Shader::SetInt(const std::string& name, GLint value)
+{
+	GLint location = GetUniformLocation(name);
+	if (location >= 0)
+		glProgramUniform1i(ProgramID, location, value);
+}
+
+void Shader::SetFloat(const std::string& name, float value)
+{
+	GLint location = GetUniformLocation(name);
+	if (location >= 0)
+		glProgramUniform1f(ProgramID, location, value);
+}
+
+void Shader::SetVec3(const std::string& name, const glm::vec3& value)
+{
+	GLint location = GetUniformLocation(name);
+	if (location >= 0)
+		glProgramUniform3fv(ProgramID, location, 1, glm::value_ptr(value));
 }
 
 void Shader::compileError(GLuint shader, const char* type)
 {
 	GLint success;
 	char infoLog[512];
-	if (type != "PROGRAM")
+	if (strcmp(type, "PROGRAM") != 0)
 	{
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 		if (success == GL_FALSE)
@@ -53,10 +131,10 @@ void Shader::compileError(GLuint shader, const char* type)
 	}
 	else
 	{
-		glGetProgramiv(shader, GL_COMPILE_STATUS, &success);
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
 		if (success == GL_FALSE)
 		{
-			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			glGetProgramInfoLog(shader, 512, NULL, infoLog);
 			std::cerr << "ERROR::SHADER_LINKING_ERROR: " << type << "\n" << infoLog << std::endl;
 		}
 	}
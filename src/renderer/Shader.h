@@ -1,17 +1,36 @@
 #pragma once
+#include <string>
+#include <unordered_map>
+
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include "../src/utils/File.h"
 
+// Every active uniform is looked up once when the program is linked; the setters
+// use that table and glProgramUniform, so they need neither the driver's string
+// lookup nor an active program. Uniforms the program does not have are ignored.
+// Camera and lighting come from the Frame uniform block (FrameUniforms) instead.
 class Shader
 {
 public:
 	Shader(const char* vertexFile, const char* fragmentFile);
+	// Compute-only program
+	Shader(const char* computeFile);
 
 	void Activate();
 	void Delete();
 
+	// Location of an active uniform, -1 if the program has none by that name
+	GLint GetUniformLocation(const std::string& name) const;
+	void SetInt(const std::string& name, GLint value);
+	void SetFloat(const std::string& name, float value);
+	void SetVec3(const std::string& name, const glm::vec3& value);
+
 	GLuint ProgramID;
 private:
+	void Reflect();
 
 	void compileError(GLuint shader, const char* type);
+
+	std::unordered_map<std::string, GLint> m_Uniforms;
 };
\ No newline at end of file
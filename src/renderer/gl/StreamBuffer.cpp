@@ -0,0 +1,100 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+
+uint64_t StreamBuffer::s_Frame = 0;
+
+// Keeps every allocation aligned for any vertex attribute type and for
+// binding a range as a uniform or shader storage buffer
+static const GLsizeiptr Alignment = 256;
+
+StreamBuffer::StreamBuffer(GLsizeiptr sectionSize)
+{
+	Allocate(std::max<GLsizeiptr>(sectionSize, Alignment));
+	m_Frame = s_Frame;
+}
+
+void StreamBuffer::Allocate(GLsizeiptr sectionSize)
+{
+	m_SectionSize = (sectionSize + Alignment - 1) / Alignment * Alignment;
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	glBufferStorage(GL_ARRAY_BUFFER, m_SectionSize * Sections, nullptr, flags);
+	m_Data = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, m_SectionSize * Sections, flags));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_Section = 0;
+	m_Head = 0;
+}
+
+void StreamBuffer::Wait(int section)
+{
+	GLsync fence = m_Fences[section];
+	if (!fence)
+		return;
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	glDeleteSync(fence);
+	m_Fences[section] = nullptr;
+}
+
+void* StreamBuffer::Map(GLsizeiptr size)
+{
+	// First write of a new frame: fence the section the last frame drew from and move on
+	if (m_Frame != s_Frame)
+	{
+		m_Frame = s_Frame;
+		m_Fences[m_Section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_Section = (m_Section + 1) % Sections;
+		m_Head = 0;
+		Wait(m_Section);
+	}
+
+	if (m_Head + size > m_SectionSize)
+	{
+		// Draws already issued keep the old storage alive until they complete
+		GLsizeiptr needed = m_Head + size;
+		Delete();
+		Allocate(std::max(m_SectionSize * 2, needed));
+	}
+
+	m_Offset = m_Section * m_SectionSize + m_Head;
+	m_Head += (size + Alignment - 1) / Alignment * Alignment;
+	return m_Data + m_Offset;
+}
+
+GLintptr StreamBuffer::GetOffset() const
+{
+	return m_Offset;
+}
+
+void StreamBuffer::Bind()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, ID);
+}
+
+void StreamBuffer::Unbind()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::Delete()
+{
+	for (GLsync& fence : m_Fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	// Deleting a buffer unmaps it
+	glDeleteBuffers(1, &ID);
+	m_Data = nullptr;
+}
+
+void StreamBuffer::EndFrame()
+{
+	s_Frame++;
+}
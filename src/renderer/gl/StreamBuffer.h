@@ -0,0 +1,41 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+// Persistently mapped vertex buffer for data rewritten every frame.
+// The storage is split into Sections regions used round robin; a fence guards
+// each region so the CPU never writes over data the GPU is still reading.
+class StreamBuffer
+{
+public:
+	StreamBuffer(GLsizeiptr sectionSize);
+
+	// Returns write access to size bytes in this frame's section. The bytes live at
+	// GetOffset() in the buffer until the same section comes around again.
+	void* Map(GLsizeiptr size);
+	GLintptr GetOffset() const;
+
+	void Bind();
+	void Unbind();
+	void Delete();
+
+	// Marks the end of a frame for every stream buffer; call once after the frame's draws
+	static void EndFrame();
+
+	static const int Sections = 3;
+
+	GLuint ID;
+private:
+	void Allocate(GLsizeiptr sectionSize);
+	void Wait(int section);
+
+	GLsizeiptr m_SectionSize = 0;
+	uint8_t* m_Data = nullptr;
+	GLsync m_Fences[Sections] = {};
+	int m_Section = 0;
+	GLsizeiptr m_Head = 0;
+	GLintptr m_Offset = 0;
+	uint64_t m_Frame = 0;
+
+	static uint64_t s_Frame;
+};
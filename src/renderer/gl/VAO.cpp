@@ -5,14 +5,25 @@ VAO::VAO()
 	glGenVertexArrays(1, &ID);
 }
 
-void VAO::LinkAttrib(VBO& vbo, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, void* offset)
+void VAO::LinkAttrib(VBO& vbo, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, void* offset, GLuint divisor)
 {
 	vbo.Bind();
 	glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
 	glEnableVertexAttribArray(layout);
+	glVertexAttribDivisor(layout, divisor);
 	vbo.Unbind();
 }
 
+// Stream buffers hand out a new offset every frame, so these links are refreshed before each draw
+void VAO::LinkAttrib(StreamBuffer& buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, GLintptr offset, GLuint divisor)
+{
+	buffer.Bind();
+	glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, (void*)offset);
+	glEnableVertexAttribArray(layout);
+	glVertexAttribDivisor(layout, divisor);
+	buffer.Unbind();
+}
+
 void VAO::Bind()
 {
 	glBindVertexArray(ID);
@@ -2,13 +2,15 @@
 #include <glad/glad.h>
 
 #include "VBO.h"
+#include "StreamBuffer.h"
 
 class VAO
 {
 public:
 	VAO();
 
-	void LinkAttrib(VBO& vbo, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, void* offset);
+	void LinkAttrib(VBO& vbo, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, void* offset, GLuint divisor=0);
+	void LinkAttrib(StreamBuffer& buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizei stride, GLintptr offset, GLuint divisor=0);
 	void Bind();
 	void Unbind();
 	void Delete();
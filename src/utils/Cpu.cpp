@@ -0,0 +1,76 @@
+#include "Cpu.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define UNIVERSE_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define UNIVERSE_X86 1
+#endif
+
+#ifdef UNIVERSE_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, leaf, subleaf);
+	for (int i = 0; i < 4; i++)
+		regs[i] = static_cast<unsigned int>(info[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+SimdLevel DetectSimdLevel()
+{
+#ifdef UNIVERSE_X86
+	unsigned int regs[4];
+	cpuid(0, 0, regs);
+	if (regs[0] < 7)
+		return SimdLevel::Scalar;
+
+	cpuid(1, 0, regs);
+	bool osxsave = (regs[2] >> 27) & 1;
+	bool avx = (regs[2] >> 28) & 1;
+	bool fma = (regs[2] >> 12) & 1;
+	if (!osxsave || !avx || !fma)
+		return SimdLevel::Scalar;
+
+	// The OS has to save the YMM (and for AVX-512 also the ZMM/opmask) state
+	unsigned long long xcr0 = xgetbv();
+	if ((xcr0 & 0x6) != 0x6)
+		return SimdLevel::Scalar;
+
+	cpuid(7, 0, regs);
+	bool avx2 = (regs[1] >> 5) & 1;
+	bool avx512f = (regs[1] >> 16) & 1;
+	if (avx512f && (xcr0 & 0xE6) == 0xE6)
+		return SimdLevel::AVX512;
+	if (avx2)
+		return SimdLevel::AVX2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::AVX512: return "AVX-512";
+	case SimdLevel::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
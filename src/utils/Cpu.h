@@ -0,0 +1,12 @@
+#pragma once
+
+enum class SimdLevel
+{
+	Scalar,
+	AVX2,
+	AVX512
+};
+
+// Highest SIMD level supported by both the CPU and the OS
+SimdLevel DetectSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char* path)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Error opening file: " << path << std::endl;
+		return;
+	}
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return;
+	m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+		return;
+	m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_Data)
+		m_Size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+}
+#else
+MappedFile::MappedFile(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		std::cerr << "Error opening file: " << path << std::endl;
+		return;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			m_Data = static_cast<const uint8_t*>(data);
+			m_Size = static_cast<size_t>(info.st_size);
+		}
+	}
+	// The mapping stays valid after the descriptor is closed
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+}
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file; pages are read in on first touch
+class MappedFile
+{
+public:
+	explicit MappedFile(const char* path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+private:
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
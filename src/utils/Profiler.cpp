@@ -0,0 +1,147 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+Profiler::Profiler()
+	: m_Epoch(Clock::now()), m_Frames(History)
+{
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	if (enabled == IsEnabled())
+		return;
+	if (enabled)
+		m_Thread = std::this_thread::get_id();
+	else
+		m_InFrame = false; // a frame cut short is dropped rather than kept half recorded
+	m_Enabled.store(enabled, std::memory_order_release);
+}
+
+void Profiler::BeginFrame()
+{
+	if (!IsEnabled())
+		return;
+	m_FrameStart = Clock::now();
+	m_Depth = 0;
+
+	ProfileFrame& frame = m_Frames[m_Head];
+	frame.Index = ++m_FrameIndex;
+	frame.Start = std::chrono::duration<double>(m_FrameStart - m_Epoch).count();
+	frame.Duration = 0;
+	frame.GpuResolved = false;
+	frame.Events.clear();
+	m_InFrame = true;
+}
+
+void Profiler::EndFrame()
+{
+	if (!m_InFrame)
+		return;
+	m_Frames[m_Head].Duration = GetFrameTime();
+	m_InFrame = false;
+	m_Head = (m_Head + 1) % History;
+	if (m_Count < History)
+		m_Count++;
+}
+
+int Profiler::BeginScope(const char* name)
+{
+	if (!IsEnabled() || std::this_thread::get_id() != m_Thread || !m_InFrame)
+		return -1;
+	std::vector<ProfileEvent>& events = m_Frames[m_Head].Events;
+	events.push_back({ name, GetFrameTime(), 0.0, m_Depth++, false });
+	return static_cast<int>(events.size() - 1);
+}
+
+void Profiler::EndScope(int event)
+{
+	std::vector<ProfileEvent>& events = m_Frames[m_Head].Events;
+	if (!m_InFrame || event >= static_cast<int>(events.size()))
+		return;
+	events[event].Duration = GetFrameTime() - events[event].Start;
+	m_Depth--;
+}
+
+double Profiler::GetFrameTime() const
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - m_FrameStart).count();
+}
+
+void Profiler::AddGpuEvent(uint64_t frame, const char* name, double start, double duration)
+{
+	if (ProfileFrame* target = FindFrame(frame))
+		target->Events.push_back({ name, start, duration, 0, true });
+}
+
+void Profiler::ResolveGpuFrame(uint64_t frame)
+{
+	if (ProfileFrame* target = FindFrame(frame))
+		target->GpuResolved = true;
+}
+
+ProfileFrame* Profiler::FindFrame(uint64_t index)
+{
+	// Completed frames sit in the ring in index order, newest just before m_Head
+	if (m_Count == 0)
+		return nullptr;
+	ProfileFrame& newest = m_Frames[(m_Head + History - 1) % History];
+	if (index > newest.Index || newest.Index - index >= m_Count)
+		return nullptr;
+	ProfileFrame& frame = m_Frames[(m_Head + History - 1 - size_t(newest.Index - index)) % History];
+	return frame.Index == index ? &frame : nullptr;
+}
+
+const ProfileFrame& Profiler::GetFrame(size_t i) const
+{
+	return m_Frames[(m_Head + History - m_Count + i) % History];
+}
+
+static void WriteTraceEvent(std::ofstream& out, bool& first, const char* name, double ts, double dur, int tid)
+{
+	out << (first ? "\n" : ",\n") << "{\"name\":\"";
+	for (const char* c = name; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			out << '\\';
+		out << *c;
+	}
+	out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+	first = false;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) const
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		std::cerr << "Error opening file: " << path << std::endl;
+		return false;
+	}
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	// Timestamps and durations are in microseconds; CPU and GPU get a track each
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},";
+	out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	bool first = false;
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		const ProfileFrame& frame = GetFrame(i);
+		double frameStart = frame.Start * 1e6;
+		WriteTraceEvent(out, first, "Frame", frameStart, frame.Duration * 1e3, 1);
+		for (const ProfileEvent& event : frame.Events)
+			WriteTraceEvent(out, first, event.Name, frameStart + event.Start * 1e3, event.Duration * 1e3, event.Gpu ? 2 : 1);
+	}
+	out << "\n]}\n";
+	return static_cast<bool>(out);
+}
+
+Profiler& Profiler::Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
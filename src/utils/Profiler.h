@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One timed stage. Times are milliseconds from the start of its frame.
+struct ProfileEvent
+{
+	const char* Name; // string literal, never copied
+	double Start;
+	double Duration;
+	uint16_t Depth;
+	bool Gpu;
+};
+
+struct ProfileFrame
+{
+	uint64_t Index;
+	double Start;	 // seconds since the profiler was created
+	double Duration; // milliseconds
+	bool GpuResolved; // GPU events arrive a few frames late
+	std::vector<ProfileEvent> Events;
+};
+
+// Collects nested CPU scopes of the frame loop into a ring of recent frames.
+// Only the thread that enabled it records; scopes opened on other threads (e.g. the
+// trajectory predictor running the same gravity code) are ignored.
+// While disabled every call returns after a single flag test.
+class Profiler
+{
+public:
+	Profiler();
+
+	// Call from the thread that runs BeginFrame()/EndFrame()
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return m_Enabled.load(std::memory_order_acquire); }
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Returns an event handle for EndScope, or -1 if nothing is recorded
+	int BeginScope(const char* name);
+	void EndScope(int event);
+
+	// GPU times for an earlier frame; start is in ms from that frame's start
+	void AddGpuEvent(uint64_t frame, const char* name, double start, double duration);
+	void ResolveGpuFrame(uint64_t frame);
+	// Milliseconds since the current frame began, for placing GPU work on the timeline
+	double GetFrameTime() const;
+	uint64_t GetFrameIndex() const { return m_FrameIndex; }
+
+	// Completed frames, oldest first
+	size_t GetFrameCount() const { return m_Count; }
+	const ProfileFrame& GetFrame(size_t i) const;
+	// Writes the history in the Chrome trace event format (chrome://tracing, Perfetto)
+	bool ExportChromeTrace(const std::string& path) const;
+
+	static const size_t History = 300;
+
+	static Profiler& Get();
+private:
+	using Clock = std::chrono::steady_clock;
+
+	ProfileFrame* FindFrame(uint64_t index);
+
+	std::atomic<bool> m_Enabled{ false };
+	bool m_InFrame = false;
+	std::thread::id m_Thread; // only written while disabled
+	Clock::time_point m_Epoch;
+	Clock::time_point m_FrameStart;
+	uint64_t m_FrameIndex = 0;
+	uint16_t m_Depth = 0;
+
+	std::vector<ProfileFrame> m_Frames; // ring, reused so recording does not allocate
+	size_t m_Head = 0;					// slot of the frame being recorded
+	size_t m_Count = 0;
+};
+
+// Times the enclosing block on the CPU
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: m_Event(Profiler::Get().IsEnabled() ? Profiler::Get().BeginScope(name) : -1) {}
+	~ProfileScope()
+	{
+		if (m_Event >= 0)
+			Profiler::Get().EndScope(m_Event);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+	int m_Event;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
@@ -0,0 +1,137 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	Start(threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Resize(unsigned int threads)
+{
+	Stop();
+	Start(threads);
+}
+
+void ThreadPool::Start(unsigned int threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	m_Stopping = false;
+	m_Queues.clear();
+	for (unsigned int i = 0; i < threads; i++)
+		m_Queues.push_back(std::make_unique<Queue>());
+	for (unsigned int i = 1; i < threads; i++)
+		m_Threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Stopping = true;
+	}
+	m_Wake.notify_all();
+	for (std::thread& thread : m_Threads)
+		thread.join();
+	m_Threads.clear();
+}
+
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (end <= begin)
+		return;
+	if (grain == 0)
+		grain = 1;
+
+	size_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1 || m_Threads.empty())
+	{
+		for (size_t b = begin; b < end; b += grain)
+			fn(b, std::min(b + grain, end));
+		return;
+	}
+
+	Job job;
+	job.Fn = &fn;
+	job.Remaining = chunks;
+
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Pending += chunks;
+	}
+	// Deal the chunks out round-robin; idle workers steal from the front of other queues
+	for (size_t c = 0; c < chunks; c++)
+	{
+		size_t b = begin + c * grain;
+		Queue& queue = *m_Queues[c % m_Queues.size()];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Tasks.push_back({ &job, b, std::min(b + grain, end) });
+	}
+	m_Wake.notify_all();
+
+	// The caller works too instead of blocking
+	while (job.Remaining.load(std::memory_order_acquire) > 0)
+		if (!RunOne(0))
+			std::this_thread::yield();
+}
+
+bool ThreadPool::RunOne(size_t index)
+{
+	Task task{};
+	bool found = false;
+	{
+		Queue& own = *m_Queues[index];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		if (!own.Tasks.empty())
+		{
+			task = own.Tasks.back();
+			own.Tasks.pop_back();
+			found = true;
+		}
+	}
+	for (size_t i = 1; !found && i < m_Queues.size(); i++)
+	{
+		Queue& victim = *m_Queues[(index + i) % m_Queues.size()];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+		if (!victim.Tasks.empty())
+		{
+			task = victim.Tasks.front();
+			victim.Tasks.pop_front();
+			found = true;
+		}
+	}
+	if (!found)
+		return false;
+
+	m_Pending--;
+	(*task.Owner->Fn)(task.Begin, task.End);
+	task.Owner->Remaining.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	while (true)
+	{
+		if (RunOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_Wake.wait(lock, [this] { return m_Stopping || m_Pending > 0; });
+		if (m_Stopping)
+			return;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool with per-worker deques and work stealing.
+// ParallelFor always splits a range at the same grain boundaries, so as long as each
+// chunk writes its own outputs the result does not depend on which thread ran it.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Total number of threads doing work, including the calling thread. 0 picks the core count.
+	void Resize(unsigned int threads);
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_Threads.size()) + 1; }
+
+	void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+	// Shared pool used by the simulation passes
+	static ThreadPool& Get();
+private:
+	struct Job
+	{
+		const std::function<void(size_t, size_t)>* Fn;
+		std::atomic<size_t> Remaining;
+	};
+	struct Task
+	{
+		Job* Owner;
+		size_t Begin, End;
+	};
+	struct Queue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	void Start(unsigned int threads);
+	void Stop();
+	void WorkerLoop(size_t index);
+	bool RunOne(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> m_Queues; // queue 0 is fed by external callers
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_SleepMutex;
+	std::condition_variable m_Wake;
+	std::atomic<size_t> m_Pending{ 0 };
+	bool m_Stopping = false;
+};